@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <Face.h>
+
+/** @brief Number of landmark points the SDK reports per face
+ */
+const int SYNTHETIC_FACE_POINTS = 34;
+
+/** @brief SyntheticFaces builds faces laid out on a grid over an image, so rendering can be measured
+ * without a detector or a camera. Each face has 34 landmark points around the centre of its cell,
+ * and metrics that drift from frame to frame, so some rows of the HUD change on every frame as
+ * they do on a live stream.
+ * @param count  -- Number of faces
+ * @param width  -- Width of the image the faces are drawn on
+ * @param height -- Height of the image the faces are drawn on
+ * @param frame  -- Index of the frame, moves the metrics and the landmarks slightly
+ */
+inline std::map<affdex::FaceId, affdex::Face> syntheticFaces(const int count, const int width, const int height,
+                                                            const int frame)
+{
+    std::map<affdex::FaceId, affdex::Face> faces;
+    int columns = 1;
+    while (columns * columns < count) columns++;
+    const int rows = (count + columns - 1) / columns;
+    const float cell_width = (float)width / columns;
+    const float cell_height = (float)height / rows;
+    // Leaves room for the metric columns on both sides of the box
+    const float radius = std::min(cell_width, cell_height) * 0.15f;
+
+    for (int i = 0; i < count; i++)
+    {
+        affdex::Face face;
+        face.id = i;
+
+        // Every metric follows its own slow wave, so a few of them change per frame
+        float* emotions = reinterpret_cast<float*>(&face.emotions);
+        for (size_t m = 0; m < sizeof(face.emotions) / sizeof(float); m++)
+        {
+            emotions[m] = 50.0f + 50.0f * std::sin(frame * 0.05f + i + m * 0.7f);
+        }
+        face.emotions.valence = 100.0f * std::sin(frame * 0.03f + i);
+        float* expressions = reinterpret_cast<float*>(&face.expressions);
+        for (size_t m = 0; m < sizeof(face.expressions) / sizeof(float); m++)
+        {
+            expressions[m] = 50.0f + 50.0f * std::sin(frame * 0.05f + i + m * 0.3f);
+        }
+        face.emojis.dominantEmoji = affdex::Emoji::Relaxed;
+        face.appearance.gender = affdex::Gender::Female;
+        face.appearance.glasses = affdex::Glasses::No;
+        face.appearance.age = affdex::Age::AGE_25_34;
+        face.appearance.ethnicity = affdex::Ethnicity::CAUCASIAN;
+        face.measurements.orientation.pitch = 10.0f * std::sin(frame * 0.02f + i);
+        face.measurements.orientation.yaw = 20.0f * std::sin(frame * 0.04f + i);
+        face.measurements.orientation.roll = 5.0f * std::sin(frame * 0.01f + i);
+        face.measurements.interocularDistance = radius * 0.6f;
+
+        const float cx = cell_width * (i % columns + 0.5f) + std::sin(frame * 0.1f + i) * 2.0f;
+        const float cy = cell_height * (i / columns + 0.5f) + std::cos(frame * 0.1f + i) * 2.0f;
+        face.featurePoints.resize(SYNTHETIC_FACE_POINTS);
+        for (int p = 0; p < SYNTHETIC_FACE_POINTS; p++)
+        {
+            // Points on concentric ellipses, roughly where the outline and features of a face are
+            const float angle = p * 2.0f * 3.14159265f / 11.0f;
+            const float ring = 1.0f - (p % 3) * 0.3f;
+            face.featurePoints[p].id = p;
+            face.featurePoints[p].x = cx + std::cos(angle) * radius * 0.8f * ring;
+            face.featurePoints[p].y = cy + std::sin(angle) * radius * ring;
+        }
+        faces[face.id] = face;
+    }
+    return faces;
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "Visualizer.h"
+
+namespace
+{
+    // The colour generators as they were before the lookup tables, computed on every call
+
+    cv::Scalar redGreenFormula(const float red_val, const float green_val, const float val)
+    {
+        float norm_val = ( val - red_val ) / ( green_val - red_val );
+        norm_val = norm_val < 0.0 ? 0.0 : norm_val;
+        norm_val = norm_val > 1.0 ? 1.0 : norm_val;
+        const int B = 0;
+        const int G = norm_val * 255;
+        const int R = ( 1.0 - norm_val ) * 255;
+        return cv::Scalar( B, G, R );
+    }
+
+    cv::Scalar linearFormula(const float val1, const float val2, const cv::Scalar& color1, const cv::Scalar& color2,
+                             const float val)
+    {
+        float norm_val = ( val - val1 ) / ( val2 - val1 );
+        const int B = color1.val[0] * (1.0f-norm_val) + color2.val[0]*norm_val;
+        const int G = color1.val[1] * (1.0f-norm_val) + color2.val[1]*norm_val;
+        const int R = color1.val[2] * (1.0f-norm_val) + color2.val[2]*norm_val;
+        return cv::Scalar( B, G, R );
+    }
+
+    double largestDifference(const cv::Scalar& a, const cv::Scalar& b)
+    {
+        double diff = 0;
+        for (int c = 0; c < 3; c++) diff = std::max(diff, std::abs(a.val[c] - b.val[c]));
+        return diff;
+    }
+
+    void report(const char* name, const int64 ticks, const size_t lookups)
+    {
+        const double ns = 1e9 * ticks / cv::getTickFrequency() / lookups;
+        std::cout << "  " << std::left << std::setw(22) << name << std::right << std::setw(8) << ns << " ns/lookup  "
+                  << std::setw(8) << 1e3 / ns << " M lookups/s" << std::endl;
+    }
+}
+
+/** Measures the throughput of the colour lookup tables of the Visualizer against the formulas they
+ * replaced, on metric values spread over their whole range, and how far the table entries are from
+ * the exact colours. The values are read from memory, as the HUD reads them from the faces.
+ *
+ * Usage: bench-color-lut [lookups]
+ */
+int main(int argc, char ** argsv)
+{
+    const size_t lookups = argc > 1 ? std::strtoul(argsv[1], nullptr, 10) : 10000000;
+
+    // Valence spans [-100, 100], the other metrics [0, 100]
+    std::vector<float> values(4096);
+    // Scattered over the range, so consecutive lookups hit different entries
+    for (size_t i = 0; i < values.size(); i++) values[i] = -100.0f + 200.0f * ((i * 2477) % values.size()) / values.size();
+    const size_t mask = values.size() - 1;
+
+    const cv::Scalar white(255, 255, 255);
+    const cv::Scalar yellow(0, 255, 255);
+    int64 start = cv::getTickCount();
+    const ColorgenRedGreen red_green(-100, 100);
+    const ColorgenLinear white_yellow(0, 100, white, yellow);
+    const int64 build_ticks = cv::getTickCount() - start;
+
+    // Summed so the lookups are not optimized away
+    double sum = 0;
+
+    start = cv::getTickCount();
+    for (size_t i = 0; i < lookups; i++) sum += redGreenFormula(-100, 100, values[i & mask]).val[1];
+    const int64 red_green_formula = cv::getTickCount() - start;
+
+    start = cv::getTickCount();
+    for (size_t i = 0; i < lookups; i++) sum += red_green(values[i & mask]).val[1];
+    const int64 red_green_lut = cv::getTickCount() - start;
+
+    start = cv::getTickCount();
+    for (size_t i = 0; i < lookups; i++) sum += linearFormula(0, 100, white, yellow, std::abs(values[i & mask])).val[0];
+    const int64 linear_formula = cv::getTickCount() - start;
+
+    start = cv::getTickCount();
+    for (size_t i = 0; i < lookups; i++) sum += white_yellow(std::abs(values[i & mask])).val[0];
+    const int64 linear_lut = cv::getTickCount() - start;
+
+    double red_green_error = 0;
+    double linear_error = 0;
+    for (float val = -100.0f; val <= 100.0f; val += 0.01f)
+    {
+        red_green_error = std::max(red_green_error, largestDifference(red_green(val), redGreenFormula(-100, 100, val)));
+        const float metric = std::abs(val);
+        linear_error = std::max(linear_error, largestDifference(white_yellow(metric), linearFormula(0, 100, white, yellow, metric)));
+    }
+
+    std::cout << "Colour generators, " << lookups << " lookups each (checksum " << sum << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    report("red-green formula", red_green_formula, lookups);
+    report("red-green table", red_green_lut, lookups);
+    report("white-yellow formula", linear_formula, lookups);
+    report("white-yellow table", linear_lut, lookups);
+    std::cout << "  tables built in " << 1e6 * build_ticks / cv::getTickFrequency() << " us, largest difference "
+              << red_green_error << " (red-green) and " << linear_error << " (white-yellow) levels" << std::endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "PhotoDetector.h"
+
+/** Measures what --detectScale costs and saves: the time to resize a frame with area interpolation
+ * into a reused buffer, as opencv-webcam-demo does before handing it to the detector, at scales 1,
+ * 0.5 and 0.25 of 640x480, 1280x720 and 1920x1080 frames. Given the classifier data folder and a
+ * photo with faces, it also times a PhotoDetector on the photo at each scale and reports the faces
+ * it still finds, which is where the scale pays off or loses faces.
+ *
+ * Usage: bench-detect-scale [frames] [data folder] [photo]
+ */
+
+namespace
+{
+    const float SCALES[] = { 1.0f, 0.5f, 0.25f };
+
+    class CountingListener : public affdex::ImageListener
+    {
+    public:
+
+        CountingListener() : faces(0) {}
+
+        void onImageResults(std::map<affdex::FaceId, affdex::Face> results, affdex::Frame image) override
+        {
+            faces = results.size();
+        }
+
+        void onImageCapture(affdex::Frame image) override {}
+
+        size_t faces;
+    };
+
+    // Frame with detail at every scale, the cost of the resize does not depend on the content
+    cv::Mat patternFrame(const int width, const int height)
+    {
+        cv::Mat frame(height, width, CV_8UC3);
+        for (int y = 0; y < height; y++)
+        {
+            unsigned char* row = frame.ptr(y);
+            for (int x = 0; x < width * 3; x++)
+            {
+                row[x] = (unsigned char)((x * 7 + y * 13 + (x * y) / 5) & 255);
+            }
+        }
+        return frame;
+    }
+
+    void benchResize(const int width, const int height, const int frames)
+    {
+        const cv::Mat frame = patternFrame(width, height);
+        cv::Mat buffer;
+        std::cout << "  " << width << "x" << height;
+        for (float scale : SCALES)
+        {
+            int64 ticks = 0;
+            if (scale != 1.0f)
+            {
+                for (int i = 0; i < frames; i++)
+                {
+                    const int64 start = cv::getTickCount();
+                    cv::resize(frame, buffer, cv::Size(), scale, scale, cv::INTER_AREA);
+                    ticks += cv::getTickCount() - start;
+                }
+            }
+            // At scale 1 the frame is handed over as it is
+            std::cout << "  " << std::setprecision(2) << scale << ": " << std::setprecision(3)
+                      << 1000.0 * ticks / cv::getTickFrequency() / frames << " ms";
+        }
+        std::cout << std::endl;
+    }
+
+    void benchDetector(const std::string& data_folder, const std::string& photo, const int frames)
+    {
+        const cv::Mat image = cv::imread(photo);
+        if (image.empty())
+        {
+            std::cerr << "Unable to read " << photo << std::endl;
+            return;
+        }
+
+        CountingListener listener;
+        affdex::PhotoDetector detector(1, affdex::FaceDetectorMode::LARGE_FACES);
+        detector.setClassifierPath(affdex::path(data_folder.begin(), data_folder.end()));
+        detector.setDetectAllEmotions(true);
+        detector.setDetectAllExpressions(true);
+        detector.setDetectAllEmojis(true);
+        detector.setDetectAllAppearances(true);
+        detector.setImageListener(&listener);
+        detector.start();
+
+        std::cout << "PhotoDetector on " << photo << " (" << image.cols << "x" << image.rows << "), "
+                  << frames << " frames" << std::endl;
+        cv::Mat buffer;
+        for (float scale : SCALES)
+        {
+            if (scale != 1.0f) cv::resize(image, buffer, cv::Size(), scale, scale, cv::INTER_AREA);
+            const cv::Mat& scaled = scale != 1.0f ? buffer : image;
+
+            int64 ticks = 0;
+            for (int i = 0; i < frames; i++)
+            {
+                affdex::Frame frame(scaled.cols, scaled.rows, scaled.data, affdex::Frame::COLOR_FORMAT::BGR, (float)i);
+                const int64 start = cv::getTickCount();
+                detector.process(frame);
+                ticks += cv::getTickCount() - start;
+            }
+            const double ms = 1000.0 * ticks / cv::getTickFrequency() / frames;
+            std::cout << "  " << std::setprecision(2) << scale << ": " << std::setprecision(1) << ms << " ms/frame  "
+                      << 1000.0 / ms << " frames/s  " << listener.faces << " faces" << std::endl;
+        }
+        detector.stop();
+    }
+}
+
+int main(int argc, char ** argsv)
+{
+    const int frames = argc > 1 ? std::atoi(argsv[1]) : 200;
+    std::cout << std::fixed;
+
+    std::cout << "Resize with INTER_AREA into a reused buffer, " << frames << " frames, per frame" << std::endl;
+    benchResize(640, 480, frames);
+    benchResize(1280, 720, frames);
+    benchResize(1920, 1080, frames);
+
+    if (argc > 3)
+    {
+        benchDetector(argsv[2], argsv[3], std::max(1, frames / 10));
+    }
+    return 0;
+}
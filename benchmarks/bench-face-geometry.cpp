@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "FaceGeometry.h"
+#include "SyntheticFaces.h"
+
+namespace
+{
+    // The bounding box as PlottingImageListener computed it before: the points copied and
+    // scanned once per corner, and the corners pushed into a new vector
+
+    cv::Point2f minPoint(const affdex::VecFeaturePoint points)
+    {
+        affdex::VecFeaturePoint::const_iterator it = points.begin();
+        affdex::FeaturePoint ret = *it;
+        for (; it != points.end(); it++)
+        {
+            if (it->x < ret.x) ret.x = it->x;
+            if (it->y < ret.y) ret.y = it->y;
+        }
+        return cv::Point2f(ret.x, ret.y);
+    }
+
+    cv::Point2f maxPoint(const affdex::VecFeaturePoint points)
+    {
+        affdex::VecFeaturePoint::const_iterator it = points.begin();
+        affdex::FeaturePoint ret = *it;
+        for (; it != points.end(); it++)
+        {
+            if (it->x > ret.x) ret.x = it->x;
+            if (it->y > ret.y) ret.y = it->y;
+        }
+        return cv::Point2f(ret.x, ret.y);
+    }
+
+    std::vector<cv::Point2f> scanBoundingBox(const affdex::VecFeaturePoint& points)
+    {
+        std::vector<cv::Point2f> ret;
+        cv::Point2f tl = minPoint(points);
+        cv::Point2f br = maxPoint(points);
+        ret.push_back(tl);
+        ret.push_back(br);
+        ret.push_back(cv::Point2f(br.x, tl.y));
+        ret.push_back(cv::Point2f(tl.x, br.y));
+        return ret;
+    }
+
+    template <typename Measure>
+    double nanosecondsPerFace(const std::vector<const affdex::VecFeaturePoint*>& faces, const int rounds, Measure measure)
+    {
+        // Summed so the measurements are not optimized away
+        volatile float sink = 0;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            for (const affdex::VecFeaturePoint* points : faces) sink = sink + measure(*points);
+        }
+        const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return elapsed / rounds / faces.size();
+    }
+}
+
+/** Compares the ways of measuring the landmarks of 16 faces of 34 points: the former scans for
+ * the bounding box alone, and computeFaceGeometry with and without SSE, which also give the
+ * centroid, spread and landmark distances. Needs neither OpenCV's libraries nor the SDK runtime.
+ *
+ * Usage: bench-face-geometry [rounds]
+ */
+int main(int argc, char ** argsv)
+{
+    const int rounds = argc > 1 ? std::atoi(argsv[1]) : 100000;
+    const int count = 16;
+    const std::map<affdex::FaceId, affdex::Face> faces = syntheticFaces(count, 1280, 720, 0);
+    std::vector<const affdex::VecFeaturePoint*> points;
+    for (auto& face_id_pair : faces) points.push_back(&face_id_pair.second.featurePoints);
+
+    std::cout << "Face geometry, " << count << " faces x " << SYNTHETIC_FACE_POINTS << " points, "
+              << rounds << " rounds" << std::endl << std::fixed << std::setprecision(1);
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        const double scans = nanosecondsPerFace(points, rounds, [](const affdex::VecFeaturePoint& p)
+            { return scanBoundingBox(p)[1].x; });
+        const double scalar = nanosecondsPerFace(points, rounds, [](const affdex::VecFeaturePoint& p)
+            { return computeFaceGeometryScalar(p).spread; });
+        const double vectorized = nanosecondsPerFace(points, rounds, [](const affdex::VecFeaturePoint& p)
+            { return computeFaceGeometry(p).spread; });
+        std::cout << "  bounding box scans " << std::setw(7) << scans << " ns/face   scalar geometry "
+                  << std::setw(7) << scalar << " ns/face   computeFaceGeometry " << std::setw(7) << vectorized
+                  << " ns/face" << std::endl;
+    }
+    return 0;
+}
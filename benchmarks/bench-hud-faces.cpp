@@ -0,0 +1,78 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "FaceGeometry.h"
+#include "Visualizer.h"
+#include "SyntheticFaces.h"
+
+/** Measures Visualizer::drawFaces for 1 to 32 synthetic faces, with OpenCV limited to a single
+ * thread and with its default thread pool, so the gain of the parallel HUD can be read per face
+ * count. Only the HUD is timed: the frame is refreshed and the bounding boxes are computed outside
+ * the timed section.
+ *
+ * Usage: bench-hud-faces [frames per run] [width] [height]
+ */
+int main(int argc, char ** argsv)
+{
+    const int frames = argc > 1 ? std::atoi(argsv[1]) : 300;
+    const int width = argc > 2 ? std::atoi(argsv[2]) : 1280;
+    const int height = argc > 3 ? std::atoi(argsv[3]) : 720;
+    const int warmup = 10;
+    const int face_counts[] = { 1, 2, 4, 8, 16, 32 };
+
+    const cv::Mat background(height, width, CV_8UC3, cv::Scalar(60, 60, 60));
+    cv::Mat image;
+    std::vector<std::vector<cv::Point2f> > boxes;
+
+    std::vector<int> thread_counts;
+    thread_counts.push_back(1);
+    if (cv::getNumberOfCPUs() > 1) thread_counts.push_back(cv::getNumberOfCPUs());
+
+    std::cout << "HUD rendering, " << width << "x" << height << ", " << frames << " frames per run" << std::endl;
+    std::cout << std::setw(6) << "faces";
+    for (const int threads : thread_counts) std::cout << std::setw(12) << threads << " thr";
+    std::cout << std::setw(10) << "speedup" << std::endl;
+
+    for (const int count : face_counts)
+    {
+        std::cout << std::setw(6) << count;
+        std::vector<double> ms_per_frame;
+        for (const int threads : thread_counts)
+        {
+            cv::setNumThreads(threads);
+            Visualizer viz;
+            viz.setShowWindow(false);
+
+            // The HUD prints some values to stdout, which would dominate the timings
+            std::streambuf* out = std::cout.rdbuf(nullptr);
+            int64 ticks = 0;
+            for (int frame = 0; frame < warmup + frames; frame++)
+            {
+                const std::map<affdex::FaceId, affdex::Face> faces = syntheticFaces(count, width, height, frame);
+                background.copyTo(image);
+                boxes.resize(faces.size());
+                size_t i = 0;
+                for (auto& face_id_pair : faces)
+                {
+                    boundingBoxCorners(computeFaceGeometry(face_id_pair.second.featurePoints), boxes[i++]);
+                }
+
+                const int64 start = cv::getTickCount();
+                viz.shouldRender(frame / 30.0);
+                viz.updateImage(image);
+                viz.drawFaces(faces, boxes);
+                if (frame >= warmup) ticks += cv::getTickCount() - start;
+            }
+            std::cout.rdbuf(out);
+
+            ms_per_frame.push_back(1000.0 * ticks / cv::getTickFrequency() / frames);
+            std::cout << std::setw(12) << std::fixed << std::setprecision(3) << ms_per_frame.back() << " ms ";
+        }
+        std::cout << std::setw(9) << std::setprecision(2) << ms_per_frame.front() / ms_per_frame.back() << "x" << std::endl;
+    }
+    return 0;
+}
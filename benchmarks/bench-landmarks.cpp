@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "Visualizer.h"
+#include "SyntheticFaces.h"
+
+/** Compares drawing the landmark points of all the faces with Visualizer::drawPoints, which stamps
+ * a precomputed sprite, against rasterizing a cv::circle per point as the Visualizer used to.
+ *
+ * Usage: bench-landmarks [frames] [faces]
+ */
+int main(int argc, char ** argsv)
+{
+    const int frames = argc > 1 ? std::atoi(argsv[1]) : 1000;
+    const int count = argc > 2 ? std::atoi(argsv[2]) : 16;
+    const int width = 1280;
+    const int height = 720;
+
+    const cv::Mat background(height, width, CV_8UC3, cv::Scalar(60, 60, 60));
+    cv::Mat image;
+    Visualizer viz;
+    viz.setShowWindow(false);
+
+    int64 sprite_ticks = 0;
+    int64 circle_ticks = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const std::map<affdex::FaceId, affdex::Face> faces = syntheticFaces(count, width, height, frame);
+
+        background.copyTo(image);
+        viz.updateImage(image);
+        int64 start = cv::getTickCount();
+        viz.drawPoints(faces);
+        sprite_ticks += cv::getTickCount() - start;
+
+        background.copyTo(image);
+        start = cv::getTickCount();
+        for (auto& face_id_pair : faces)
+        {
+            for (auto& point : face_id_pair.second.featurePoints)
+            {
+                cv::circle(image, cv::Point2f(point.x, point.y), 2.0f, cv::Scalar(255, 255, 255));
+            }
+        }
+        circle_ticks += cv::getTickCount() - start;
+    }
+
+    const double points = (double)frames * count * SYNTHETIC_FACE_POINTS;
+    const double sprite_ms = 1000.0 * sprite_ticks / cv::getTickFrequency() / frames;
+    const double circle_ms = 1000.0 * circle_ticks / cv::getTickFrequency() / frames;
+    std::cout << "Landmarks, " << count << " faces x " << SYNTHETIC_FACE_POINTS << " points, " << frames << " frames" << std::endl;
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "  sprite    " << sprite_ms << " ms/frame  " << std::setprecision(1)
+              << 1e9 * sprite_ticks / cv::getTickFrequency() / points << " ns/point" << std::endl;
+    std::cout << std::setprecision(4);
+    std::cout << "  cv::circle " << circle_ms << " ms/frame  " << std::setprecision(1)
+              << 1e9 * circle_ticks / cv::getTickFrequency() / points << " ns/point" << std::endl;
+    std::cout << std::setprecision(2) << "  speedup   " << circle_ms / sprite_ms << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,16 @@
+# Fails when a generated file differs from the copy checked in for the builds that do not run
+# the generator (Visual Studio, cross compiling). Line endings are ignored, git may convert them.
+# The generated file is removed on failure, so the next build generates and checks it again.
+#
+# Usage:
+# cmake -DGENERATED=<built file> -DCHECKED_IN=<file in the source tree> -DUPDATE=<how to update it>
+#       -P CompareGenerated.cmake
+
+file(READ "${GENERATED}" generated_content)
+file(READ "${CHECKED_IN}" checked_in_content)
+string(REPLACE "\r\n" "\n" generated_content "${generated_content}")
+string(REPLACE "\r\n" "\n" checked_in_content "${checked_in_content}")
+if(NOT generated_content STREQUAL checked_in_content)
+    file(REMOVE "${GENERATED}")
+    message(FATAL_ERROR "${CHECKED_IN} is out of date, regenerate it with: ${UPDATE}")
+endif()
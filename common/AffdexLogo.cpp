@@ -0,0 +1,13 @@
+#include "AffdexLogo.h"
+
+// Kept out of Visualizer.cpp, only this file has to be rebuilt when the logo changes
+#include "affdex_small_logo.h"
+
+void embeddedLogo(cv::Mat& color, cv::Mat& alpha)
+{
+    // The data is never written to, resizing always goes to new buffers
+    color = cv::Mat(affdex_small_logo_height, affdex_small_logo_width, CV_8UC3,
+                    const_cast<unsigned char*>(affdex_small_logo_bgr));
+    alpha = cv::Mat(affdex_small_logo_height, affdex_small_logo_width, CV_8UC1,
+                    const_cast<unsigned char*>(affdex_small_logo_alpha));
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+/** @brief EmbeddedLogo wraps the logo pixels generated at build time by embed-logo.
+* Nothing is decoded or copied, the matrices point at static read-only data.
+* @param color -- Receives the premultiplied BGR pixels (CV_8UC3)
+* @param alpha -- Receives the opacity of the pixels (CV_8UC1)
+*/
+void embeddedLogo(cv::Mat& color, cv::Mat& alpha);
@@ -0,0 +1,176 @@
+#include "BatchProcessor.h"
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include "VideoDetector.h"
+#include "AffdexException.h"
+
+#include "PlottingImageListener.hpp"
+#include "StatusListener.hpp"
+
+namespace
+{
+    /** @brief Stays registered with a worker's detector and forwards the results to the CSV writer of the current file
+    */
+    class BatchListener : public affdex::ImageListener
+    {
+    public:
+
+        BatchListener() : mWriter(nullptr), mFrames(0) {}
+
+        void onImageResults(std::map<affdex::FaceId, affdex::Face> faces, affdex::Frame image) override
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            if (mWriter == nullptr) return;
+            mWriter->outputToFile(faces, image.getTimestamp());
+            mFrames++;
+        }
+
+        void onImageCapture(affdex::Frame image) override {}
+
+        /** @brief SetWriter switches to the next file and returns the number of frames written to the previous one
+        */
+        unsigned long setWriter(PlottingImageListener* writer)
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            const unsigned long frames = mFrames;
+            mWriter = writer;
+            mFrames = 0;
+            return frames;
+        }
+
+    private:
+
+        std::mutex mMutex;
+        PlottingImageListener* mWriter;
+        unsigned long mFrames;
+    };
+}
+
+BatchProcessor::BatchProcessor(const int workers, const affdex::path& data_folder, const int process_framerate,
+                               const unsigned int faces, const int face_mode, const ReportCallback& callback)
+    : mWorkers(workers), mDataFolder(data_folder), mProcessFramerate(process_framerate), mFaces(faces),
+      mFaceMode(face_mode), mCallback(callback), mNext(0), mSucceeded(0), mFailed(0), mFrames(0), mStartupTime(0)
+{
+}
+
+void BatchProcessor::process(const std::vector<boost::filesystem::path>& inputs)
+{
+    mNext = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < mWorkers && (size_t)i < inputs.size(); i++)
+    {
+        threads.push_back(std::thread(&BatchProcessor::run, this, i, std::cref(inputs)));
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void BatchProcessor::report(const BatchReport& report)
+{
+    std::lock_guard<std::mutex> lg(mReportMutex);
+    if (report.succeeded) mSucceeded++;
+    else mFailed++;
+    mFrames += report.frames;
+    mCallback(report);
+}
+
+void BatchProcessor::run(const int worker, const std::vector<boost::filesystem::path>& inputs)
+{
+    BatchReport outcome;
+    outcome.worker = worker;
+
+    // Loading the classifiers is the expensive part, it is done once per worker
+    const auto started = std::chrono::steady_clock::now();
+    BatchListener listener;
+    affdex::VideoDetector detector(mProcessFramerate, mFaces, (affdex::FaceDetectorMode) mFaceMode);
+    try
+    {
+        detector.setClassifierPath(mDataFolder);
+        detector.setDetectAllEmotions(true);
+        detector.setDetectAllExpressions(true);
+        detector.setDetectAllEmojis(true);
+        detector.setDetectAllAppearances(true);
+        detector.setImageListener(&listener);
+        detector.start();
+    }
+    catch (std::exception& ex)
+    {
+        // Leave the files to the other workers, no file is counted as failed
+        outcome.succeeded = false;
+        outcome.error = std::string("Unable to start the detector: ") + ex.what();
+        outcome.frames = 0;
+        outcome.seconds = 0;
+        std::lock_guard<std::mutex> lg(mReportMutex);
+        mCallback(outcome);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lg(mReportMutex);
+        mStartupTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    // One CSV writer per worker, reopened on the file of each video: building a writer builds a
+    // whole Visualizer, which only the display needs
+    std::ofstream csvFileStream;
+    PlottingImageListener writer(csvFileStream, false);
+
+    for (size_t next = mNext++; next < inputs.size(); next = mNext++)
+    {
+        outcome.input = inputs[next];
+        outcome.output = boost::filesystem::path(inputs[next]).replace_extension(".csv");
+        outcome.succeeded = false;
+        outcome.error.clear();
+        outcome.frames = 0;
+
+        const auto file_started = std::chrono::steady_clock::now();
+        csvFileStream.open(outcome.output.c_str());
+        if (!csvFileStream.is_open())
+        {
+            outcome.error = "Unable to open csv file " + outcome.output.string();
+            outcome.seconds = 0;
+            report(outcome);
+            continue;
+        }
+
+        writer.writeHeader();
+        StatusListener status;
+        listener.setWriter(&writer);
+        detector.setProcessStatusListener(&status);
+        try
+        {
+            detector.process(affdex::path(outcome.input.native()));
+            while (status.isRunning())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            outcome.error = status.getError();
+            outcome.succeeded = outcome.error.empty();
+        }
+        catch (std::exception& ex)
+        {
+            // Any failure is reported against this file, the worker goes on with the next one
+            outcome.error = ex.what();
+            outcome.succeeded = false;
+        }
+        outcome.frames = listener.setWriter(nullptr);
+        try
+        {
+            detector.reset();
+        }
+        catch (std::exception& ex)
+        {
+            if (outcome.error.empty()) outcome.error = std::string("Unable to reset the detector: ") + ex.what();
+            outcome.succeeded = false;
+        }
+        csvFileStream.close();
+
+        outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - file_started).count();
+        report(outcome);
+    }
+
+    detector.stop();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <Frame.h>
+
+/** @brief Outcome of one file of a batch
+ */
+struct BatchReport
+{
+    boost::filesystem::path input;
+    boost::filesystem::path output;
+    int worker;
+    bool succeeded;
+    std::string error;      // Why the file failed, empty if it succeeded
+    unsigned long frames;   // Number of processed frames
+    double seconds;         // Wall time spent on the file
+};
+
+/** @brief Processes a list of video files on a fixed pool of workers. Each worker creates and starts
+ * one VideoDetector, then takes files from the shared queue until it is empty, resetting the detector
+ * between files instead of loading the classifiers again. The results of each file are written to a
+ * CSV file next to it, as for a single video.
+ */
+class BatchProcessor
+{
+public:
+
+    /** @brief Called from the worker threads, one at a time, after each file. A worker whose detector
+    * fails to start reports it with an empty input and leaves the files to the others.
+    */
+    typedef std::function<void(const BatchReport& report)> ReportCallback;
+
+    /** @brief BatchProcessor
+    * @param workers           -- Number of workers, and of detectors
+    * @param data_folder       -- Classifier data folder
+    * @param process_framerate -- Processing framerate of the detectors
+    * @param faces             -- Maximum number of faces tracked
+    * @param face_mode         -- Face detector mode
+    * @param callback          -- Receives the outcome of every file
+    */
+    BatchProcessor(const int workers, const affdex::path& data_folder, const int process_framerate,
+                   const unsigned int faces, const int face_mode, const ReportCallback& callback);
+
+    /** @brief Process runs the workers over the files and blocks until all of them are done
+    * @param inputs -- Video files, taken in order
+    */
+    void process(const std::vector<boost::filesystem::path>& inputs);
+
+    unsigned long getSucceededCount() const { return mSucceeded; }
+
+    unsigned long getFailedCount() const { return mFailed; }
+
+    unsigned long getFrameCount() const { return mFrames; }
+
+    /** @brief GetStartupTime returns the time the workers spent creating and starting their detectors, in seconds
+    */
+    double getStartupTime() const { return mStartupTime; }
+
+private:
+
+    void run(const int worker, const std::vector<boost::filesystem::path>& inputs);
+
+    void report(const BatchReport& report);
+
+    const int mWorkers;
+    const affdex::path mDataFolder;
+    const int mProcessFramerate;
+    const unsigned int mFaces;
+    const int mFaceMode;
+    const ReportCallback mCallback;
+
+    std::atomic<size_t> mNext;
+    std::mutex mReportMutex;
+    unsigned long mSucceeded;
+    unsigned long mFailed;
+    unsigned long mFrames;
+    double mStartupTime;
+};
@@ -0,0 +1,71 @@
+#include "CaptureFormat.h"
+#include <cctype>
+#include <sstream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+CaptureFormat::CaptureFormat(const std::string& fourcc)
+    : mFourcc(fourcc), mRaw(false)
+{
+}
+
+std::string CaptureFormat::name(const int fourcc)
+{
+    std::string code;
+    for (int i = 0; i < 4; i++)
+    {
+        const char c = (char)((fourcc >> (8 * i)) & 0xFF);
+        code += std::isprint((unsigned char)c) ? c : '?';
+    }
+    return code;
+}
+
+std::string CaptureFormat::describe(cv::VideoCapture& capture)
+{
+    std::ostringstream ss;
+    ss << name((int)capture.get(CV_CAP_PROP_FOURCC)) << " "
+        << capture.get(CV_CAP_PROP_FRAME_WIDTH) << "x" << capture.get(CV_CAP_PROP_FRAME_HEIGHT)
+        << " at " << capture.get(CV_CAP_PROP_FPS) << " fps";
+    return ss.str();
+}
+
+bool CaptureFormat::apply(cv::VideoCapture& capture)
+{
+    mRaw = false;
+    if (mFourcc.size() != 4) return mFourcc.empty();
+
+    const int fourcc = CV_FOURCC(mFourcc[0], mFourcc[1], mFourcc[2], mFourcc[3]);
+    capture.set(CV_CAP_PROP_FOURCC, fourcc);
+    if ((int)capture.get(CV_CAP_PROP_FOURCC) != fourcc) return false;
+
+    // Raw frames are converted here, once, instead of by the backend into a buffer of its own
+    if (mFourcc == "YUYV" || mFourcc == "YUY2")
+    {
+        mRaw = capture.set(CV_CAP_PROP_CONVERT_RGB, 0);
+    }
+    return true;
+}
+
+bool CaptureFormat::retrieve(cv::VideoCapture& capture, cv::Mat& image)
+{
+    if (!mRaw)
+    {
+        return capture.retrieve(image) && !image.empty();
+    }
+
+    if (!capture.retrieve(mBuffer) || mBuffer.empty()) return false;
+    if (mBuffer.channels() == 3)
+    {
+        // The backend converted the frame anyway, hand its buffer over instead of copying it
+        cv::swap(mBuffer, image);
+        return true;
+    }
+
+    // Raw buffers come either as 2 channel images or as a single row of bytes
+    const int width = (int)capture.get(CV_CAP_PROP_FRAME_WIDTH);
+    const int height = (int)capture.get(CV_CAP_PROP_FRAME_HEIGHT);
+    if (mBuffer.total() * mBuffer.elemSize() != (size_t)width * height * 2 || !mBuffer.isContinuous()) return false;
+
+    cv::cvtColor(mBuffer.reshape(2, height), image, CV_YUV2BGR_YUYV);
+    return true;
+}
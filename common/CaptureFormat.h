@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+/** @brief Selects the pixel format a camera delivers, and retrieves its frames as BGR with at most
+ * one conversion.
+ *
+ * MJPG trades decoding CPU for USB bandwidth and usually allows higher resolutions and rates than the
+ * raw modes. YUYV needs no decoding: the backend's own conversion to BGR is turned off, and the raw
+ * frames are converted once, straight into the caller's buffer. Backends that do not support turning
+ * the conversion off keep delivering BGR, which is then used as is.
+ */
+class CaptureFormat
+{
+public:
+
+    /** @brief CaptureFormat
+    * @param fourcc -- Four character code such as MJPG or YUYV, empty to keep the driver's choice
+    */
+    explicit CaptureFormat(const std::string& fourcc);
+
+    /** @brief Apply requests the format from an opened capture, before its size and rate are set
+    * @return false if the capture reports another format afterwards
+    */
+    bool apply(cv::VideoCapture& capture);
+
+    /** @brief Retrieve decodes the frame just grabbed into image as BGR
+    * @param capture -- Capture a frame was grabbed from
+    * @param image   -- Receives the frame, its buffer is reused when the size did not change
+    */
+    bool retrieve(cv::VideoCapture& capture, cv::Mat& image);
+
+    /** @brief Describe returns the format, size and rate the capture reports
+    */
+    static std::string describe(cv::VideoCapture& capture);
+
+    /** @brief Name returns the four characters of a code read from CV_CAP_PROP_FOURCC
+    */
+    static std::string name(const int fourcc);
+
+private:
+
+    const std::string mFourcc;
+    bool mRaw;          // Frames come from the backend as YUYV
+    cv::Mat mBuffer;    // Raw frame as retrieved from the backend
+};
@@ -0,0 +1,141 @@
+#include "CaptureThread.h"
+#include <algorithm>
+#include <iostream>
+
+CaptureThread::CaptureThread(FrameSource& source, const size_t ring_size)
+    : mSource(source), mLossless(false), mRunning(false), mFailed(false), mGrabbed(0), mDropped(0)
+{
+    const size_t size = (std::max)(ring_size, (size_t)3);
+    mRing.resize(size);
+    mStates.assign(size, FREE);
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+}
+
+void CaptureThread::start()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    if (mThread.joinable()) return;
+    mRunning = true;
+    mThread = std::thread(&CaptureThread::run, this);
+}
+
+void CaptureThread::stop()
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+const CapturedFrame* CaptureThread::acquire()
+{
+    std::unique_lock<std::mutex> lk(mMutex);
+    size_t newest = mRing.size();
+    mCondition.wait(lk, [&] {
+        newest = mRing.size();
+        for (size_t i = 0; i < mRing.size(); i++)
+        {
+            // A lossless capture hands out the oldest frame instead
+            if (mStates[i] == READY && (newest == mRing.size() || (mRing[i].index > mRing[newest].index) != mLossless)) newest = i;
+        }
+        return newest != mRing.size() || !mRunning || mFailed;
+    });
+    if (newest == mRing.size()) return nullptr;
+
+    // Older frames are never going to be consumed
+    for (size_t i = 0; i < mRing.size() && !mLossless; i++)
+    {
+        if (i != newest && mStates[i] == READY)
+        {
+            mStates[i] = FREE;
+            mDropped++;
+        }
+    }
+    mStates[newest] = IN_USE;
+    return &mRing[newest];
+}
+
+void CaptureThread::release(const CapturedFrame* frame)
+{
+    if (frame == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mStates[frame - &mRing[0]] = FREE;
+    }
+    // A lossless capture may be waiting for the buffer
+    if (mLossless) mCondition.notify_all();
+}
+
+unsigned long CaptureThread::getGrabbedCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mGrabbed;
+}
+
+unsigned long CaptureThread::getDroppedCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mDropped;
+}
+
+JitterMeter CaptureThread::getJitter()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mJitter;
+}
+
+void CaptureThread::run()
+{
+    while (true)
+    {
+        size_t slot = mRing.size();
+        {
+            std::unique_lock<std::mutex> lk(mMutex);
+            if (mLossless)
+            {
+                mCondition.wait(lk, [&] { return !mRunning || std::find(mStates.begin(), mStates.end(), FREE) != mStates.end(); });
+            }
+            if (!mRunning) break;
+
+            // A free buffer, or else the oldest frame still waiting to be consumed
+            for (size_t i = 0; i < mRing.size(); i++)
+            {
+                if (mStates[i] == FREE)
+                {
+                    slot = i;
+                    break;
+                }
+                if (mStates[i] == READY && (slot == mRing.size() || mRing[i].index < mRing[slot].index)) slot = i;
+            }
+            if (mStates[slot] == READY) mDropped++;
+            mStates[slot] = WRITING;
+        }
+
+        CapturedFrame& frame = mRing[slot];
+        double timestamp = 0;
+        if (!mSource.read(frame.image, timestamp))
+        {
+            if (!mSource.atEnd()) std::cerr << "Failed to read frame from webcam! " << std::endl;
+            std::lock_guard<std::mutex> lg(mMutex);
+            mStates[slot] = FREE;
+            mFailed = true;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            frame.timestamp = timestamp;
+            frame.index = mGrabbed++;
+            mJitter.add(frame.timestamp);
+            mStates[slot] = READY;
+        }
+        mCondition.notify_all();
+    }
+    mCondition.notify_all();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameSource.h"
+#include "JitterMeter.h"
+
+/** @brief Frame captured by a CaptureThread, owned by its ring
+ */
+struct CapturedFrame
+{
+    cv::Mat image;
+    double timestamp;       // Seconds since the start time, taken when the frame was grabbed
+    unsigned long index;    // Number of frames grabbed before this one
+};
+
+/** @brief Reads frames from a FrameSource on a dedicated thread, so slow processing or
+ * drawing never delays the camera. Frames are decoded into a ring of buffers that are reused
+ * once their size is known, and timestamped as soon as they are grabbed.
+ * The consumer always gets the newest frame; frames it had no time for are dropped and counted.
+ */
+class CaptureThread
+{
+public:
+
+    /** @brief CaptureThread
+    * @param source    -- Source of the frames, only used by the capture thread once started
+    * @param ring_size -- Number of buffers, at least 3: one being written, one being consumed, one ready
+    */
+    CaptureThread(FrameSource& source, const size_t ring_size = 4);
+
+    ~CaptureThread();
+
+    /** @brief SetLossless makes the capture thread wait for a free buffer instead of dropping
+    * frames, and the consumer get the frames in order. Only for sources that can wait, such as
+    * recordings. Call before start.
+    */
+    void setLossless(const bool lossless) { mLossless = lossless; }
+
+    void start();
+
+    /** @brief Stop ends the capture thread and wakes up a waiting consumer
+    */
+    void stop();
+
+    /** @brief Acquire waits for a frame newer than the last one acquired and lends it to the caller
+    * until release is called. Only one frame can be acquired at a time.
+    * @return The newest frame, nullptr once the capture has stopped or failed
+    */
+    const CapturedFrame* acquire();
+
+    /** @brief Release gives an acquired frame back to the ring
+    */
+    void release(const CapturedFrame* frame);
+
+    unsigned long getGrabbedCount();
+
+    unsigned long getDroppedCount();
+
+    /** @brief GetJitter statistics of the intervals between grab timestamps
+    */
+    JitterMeter getJitter();
+
+private:
+
+    enum SlotState { FREE, WRITING, READY, IN_USE };
+
+    void run();
+
+    FrameSource& mSource;
+    bool mLossless;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<CapturedFrame> mRing;
+    std::vector<SlotState> mStates;
+    bool mRunning;
+    bool mFailed;
+
+    std::thread mThread;
+
+    unsigned long mGrabbed;
+    unsigned long mDropped;
+    JitterMeter mJitter;
+};
@@ -0,0 +1,170 @@
+#include "FaceGeometry.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FACE_GEOMETRY_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    // Indices of the landmarks measured, in the SDK's 34 point layout
+    const size_t LAYOUT_POINTS = 34;
+    const int RIGHT_JAW_TOP = 0;
+    const int LEFT_JAW_TOP = 4;
+    const int RIGHT_EYE_OUTER = 16;
+    const int RIGHT_EYE_INNER = 17;
+    const int LEFT_EYE_INNER = 18;
+    const int LEFT_EYE_OUTER = 19;
+    const int RIGHT_LIP_CORNER = 20;
+    const int LEFT_LIP_CORNER = 24;
+    const int UPPER_LIP_BOTTOM = 28;
+    const int LOWER_LIP_TOP = 29;
+
+    /** @brief Running state of a pass over the points
+     */
+    struct Accumulator
+    {
+        float min_x, min_y, max_x, max_y;
+        // Sums are accumulated in double, in float the spread loses its precision for large coordinates
+        double sum_x, sum_y, sum_squares;
+    };
+
+    /** @brief AccumulateScalar adds the points [first, count) one at a time
+     */
+    void accumulateScalar(const affdex::FeaturePoint* p, size_t first, const size_t count, Accumulator& acc)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            const float x = p[i].x;
+            const float y = p[i].y;
+            acc.min_x = (std::min)(acc.min_x, x);
+            acc.min_y = (std::min)(acc.min_y, y);
+            acc.max_x = (std::max)(acc.max_x, x);
+            acc.max_y = (std::max)(acc.max_y, y);
+            acc.sum_x += x;
+            acc.sum_y += y;
+            acc.sum_squares += (double)x * x + (double)y * y;
+        }
+    }
+
+    float distance(const float ax, const float ay, const float bx, const float by)
+    {
+        return std::sqrt((ax - bx) * (ax - bx) + (ay - by) * (ay - by));
+    }
+
+    float landmarkDistance(const affdex::FeaturePoint* p, const int a, const int b)
+    {
+        return distance(p[a].x, p[a].y, p[b].x, p[b].y);
+    }
+
+    /** @brief Finish derives the geometry from a completed pass and reads the landmark distances
+     */
+    FaceGeometry finish(const affdex::VecFeaturePoint& points, const Accumulator& acc)
+    {
+        FaceGeometry geometry = FaceGeometry();
+        const size_t count = points.size();
+        const double mean_x = acc.sum_x / count;
+        const double mean_y = acc.sum_y / count;
+        const double variance = acc.sum_squares / count - (mean_x * mean_x + mean_y * mean_y);
+
+        geometry.top_left = cv::Point2f(acc.min_x, acc.min_y);
+        geometry.bottom_right = cv::Point2f(acc.max_x, acc.max_y);
+        geometry.centroid = cv::Point2f((float)mean_x, (float)mean_y);
+        geometry.spread = variance > 0 ? (float)std::sqrt(variance) : 0.0f;
+        geometry.count = count;
+
+        const affdex::FeaturePoint* p = &points[0];
+        if (count == LAYOUT_POINTS && p[0].id == 0 && p[LAYOUT_POINTS - 1].id == (int)LAYOUT_POINTS - 1)
+        {
+            geometry.eye_distance = distance((p[RIGHT_EYE_OUTER].x + p[RIGHT_EYE_INNER].x) * 0.5f,
+                                             (p[RIGHT_EYE_OUTER].y + p[RIGHT_EYE_INNER].y) * 0.5f,
+                                             (p[LEFT_EYE_OUTER].x + p[LEFT_EYE_INNER].x) * 0.5f,
+                                             (p[LEFT_EYE_OUTER].y + p[LEFT_EYE_INNER].y) * 0.5f);
+            geometry.jaw_width = landmarkDistance(p, RIGHT_JAW_TOP, LEFT_JAW_TOP);
+            geometry.mouth_width = landmarkDistance(p, RIGHT_LIP_CORNER, LEFT_LIP_CORNER);
+            geometry.mouth_opening = landmarkDistance(p, UPPER_LIP_BOTTOM, LOWER_LIP_TOP);
+        }
+        return geometry;
+    }
+
+    Accumulator startAt(const affdex::FeaturePoint& point)
+    {
+        Accumulator acc = Accumulator();
+        acc.min_x = acc.max_x = point.x;
+        acc.min_y = acc.max_y = point.y;
+        return acc;
+    }
+}
+
+FaceGeometry computeFaceGeometry(const affdex::VecFeaturePoint& points)
+{
+    const size_t count = points.size();
+    if (count == 0) return FaceGeometry();
+
+    const affdex::FeaturePoint* p = &points[0];
+    Accumulator acc = startAt(p[0]);
+    size_t i = 0;
+
+#ifdef FACE_GEOMETRY_SSE
+    if (count >= 2)
+    {
+        // Lanes hold (x, y) of an even point followed by (x, y) of an odd point
+        __m128 lo = _mm_set_ps(p[1].y, p[1].x, p[0].y, p[0].x);
+        __m128 hi = lo;
+        __m128 sum = _mm_setzero_ps();
+        __m128 squares = _mm_setzero_ps();
+        // Partial sums are flushed to double every few points to bound the float rounding
+        const size_t flush_every = 16;
+        for (; i + 1 < count; i += 2)
+        {
+            const __m128 v = _mm_set_ps(p[i + 1].y, p[i + 1].x, p[i].y, p[i].x);
+            lo = _mm_min_ps(lo, v);
+            hi = _mm_max_ps(hi, v);
+            sum = _mm_add_ps(sum, v);
+            squares = _mm_add_ps(squares, _mm_mul_ps(v, v));
+            if ((i / 2 + 1) % flush_every == 0 || i + 3 >= count)
+            {
+                float s[4], q[4];
+                _mm_storeu_ps(s, sum);
+                _mm_storeu_ps(q, squares);
+                acc.sum_x += (double)s[0] + s[2];
+                acc.sum_y += (double)s[1] + s[3];
+                acc.sum_squares += (double)q[0] + q[1] + q[2] + q[3];
+                sum = _mm_setzero_ps();
+                squares = _mm_setzero_ps();
+            }
+        }
+        float l[4], h[4];
+        _mm_storeu_ps(l, lo);
+        _mm_storeu_ps(h, hi);
+        acc.min_x = (std::min)(l[0], l[2]);
+        acc.min_y = (std::min)(l[1], l[3]);
+        acc.max_x = (std::max)(h[0], h[2]);
+        acc.max_y = (std::max)(h[1], h[3]);
+    }
+#endif
+
+    accumulateScalar(p, i, count, acc);
+    return finish(points, acc);
+}
+
+FaceGeometry computeFaceGeometryScalar(const affdex::VecFeaturePoint& points)
+{
+    const size_t count = points.size();
+    if (count == 0) return FaceGeometry();
+
+    Accumulator acc = startAt(points[0]);
+    accumulateScalar(&points[0], 0, count, acc);
+    return finish(points, acc);
+}
+
+void boundingBoxCorners(const FaceGeometry& geometry, std::vector<cv::Point2f>& corners)
+{
+    corners.resize(4);
+    corners[0] = geometry.top_left;
+    corners[1] = geometry.bottom_right;
+    corners[2] = cv::Point2f(geometry.bottom_right.x, geometry.top_left.y);
+    corners[3] = cv::Point2f(geometry.top_left.x, geometry.bottom_right.y);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+#include <Face.h>
+
+/** @brief Geometry of a face's landmark points
+ */
+struct FaceGeometry
+{
+    cv::Point2f top_left;       // Smallest x and y of the points
+    cv::Point2f bottom_right;   // Largest x and y of the points
+    cv::Point2f centroid;       // Mean of the points
+    float spread;               // Root mean square distance of the points to the centroid
+    size_t count;               // Number of points, everything else is zero when there are none
+
+    // Distances between landmarks of the SDK's 34 point layout, zero when the points do not follow it
+    float eye_distance;         // Between the centres of the eyes
+    float jaw_width;            // Between the tops of the jaw
+    float mouth_width;          // Between the lip corners
+    float mouth_opening;        // Between the bottom of the upper lip and the top of the lower lip
+};
+
+/** @brief ComputeFaceGeometry measures the landmark points in a single pass, without copying them.
+ * Two points are processed per SSE register when available; points are gathered through their
+ * x and y members, so nothing is assumed about the layout of affdex::FeaturePoint. The landmark
+ * distances are read from their points directly, they add no pass.
+ * @param points -- Landmark points of a face
+ */
+FaceGeometry computeFaceGeometry(const affdex::VecFeaturePoint& points);
+
+/** @brief ComputeFaceGeometryScalar measures the points one at a time, without SSE. The results
+ * match computeFaceGeometry: the bounds and distances exactly, the centroid and spread to float
+ * rounding. It is the reference of the tests and benchmarks.
+ * @param points -- Landmark points of a face
+ */
+FaceGeometry computeFaceGeometryScalar(const affdex::VecFeaturePoint& points);
+
+/** @brief BoundingBoxCorners fills the corners of the bounding box in the order used by the Visualizer:
+ * top left, bottom right, top right, bottom left
+ * @param geometry -- Measured geometry of the face
+ * @param corners  -- Receives the four corners, its storage is reused
+ */
+void boundingBoxCorners(const FaceGeometry& geometry, std::vector<cv::Point2f>& corners);
@@ -0,0 +1,20 @@
+#include "FrameDelay.h"
+
+void FrameDelay::push(const cv::Mat& image, const double timestamp)
+{
+    cv::Mat buffer;
+    if (!mFree.empty())
+    {
+        buffer = mFree.back();
+        mFree.pop_back();
+    }
+    // Reallocates only when the size or type changed
+    image.copyTo(buffer);
+    mFrames.push_back(std::make_pair(buffer, timestamp));
+}
+
+void FrameDelay::pop()
+{
+    mFree.push_back(mFrames.front().first);
+    mFrames.pop_front();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/** @brief Holds copies of captured frames, in order, until what they are drawn with is known.
+ * The buffers of popped frames are reused, so the steady state does not allocate.
+ */
+class FrameDelay
+{
+public:
+
+    /** @brief Push copies a frame at the end of the queue
+    * @param image     -- The frame, not referenced once push returns
+    * @param timestamp -- Timestamp of the frame in seconds
+    */
+    void push(const cv::Mat& image, const double timestamp);
+
+    /** @brief Pop forgets the oldest frame, keeping its buffer for a later push
+    */
+    void pop();
+
+    bool empty() const { return mFrames.empty(); }
+
+    size_t size() const { return mFrames.size(); }
+
+    /** @brief Front the oldest frame, valid until it is popped
+    */
+    cv::Mat& front() { return mFrames.front().first; }
+
+    double frontTimestamp() const { return mFrames.front().second; }
+
+private:
+
+    std::deque<std::pair<cv::Mat, double> > mFrames;
+    std::vector<cv::Mat> mFree;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+/** @brief Interface for consumers of the HUD annotated frames rendered by the Visualizer
+ */
+class FrameSink
+{
+public:
+
+    virtual ~FrameSink() {}
+
+    /** @brief OnFrame is called once per rendered frame from the drawing thread
+    * @param frame     -- The annotated frame, only valid for the duration of the call
+    * @param timestamp -- Timestamp of the frame in seconds
+    */
+    virtual void onFrame(const cv::Mat& frame, const double timestamp) = 0;
+};
@@ -0,0 +1,74 @@
+#include "FrameSource.h"
+#include <thread>
+
+#include "CaptureFormat.h"
+
+namespace
+{
+    // Smallest step between two timestamps, the resolution they are written with
+    const double MIN_TIMESTAMP_STEP = 1e-6;
+}
+
+CaptureClock::CaptureClock(const std::chrono::steady_clock::time_point& start, const bool use_position)
+    : mStart(start), mUsePosition(use_position), mAligned(false), mOffset(0), mLastPosition(-1), mLastTimestamp(-1)
+{
+}
+
+double CaptureClock::now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+}
+
+double CaptureClock::stamp(cv::VideoCapture& capture)
+{
+    const double steady = now();
+    if (!mUsePosition) return steady;
+
+    // Backends without buffer times report 0 or -1, some repeat the last value
+    double timestamp = steady;
+    const double position = capture.get(CV_CAP_PROP_POS_MSEC) / 1000.0;
+    if (position > 0 && position > mLastPosition)
+    {
+        if (!mAligned)
+        {
+            mOffset = steady - position;
+            mAligned = true;
+        }
+        mLastPosition = position;
+        timestamp = position + mOffset;
+    }
+
+    // The buffer times drift from the steady clock, switching between the two when a position is
+    // missing must not go back in time
+    if (timestamp <= mLastTimestamp) timestamp = mLastTimestamp + MIN_TIMESTAMP_STEP;
+    mLastTimestamp = timestamp;
+    return timestamp;
+}
+
+VideoCaptureSource::VideoCaptureSource(cv::VideoCapture& capture, const CaptureClock& clock)
+    : mCapture(capture), mClock(clock), mRealtime(false), mFormat(nullptr), mFirstPosition(-1)
+{
+}
+
+bool VideoCaptureSource::read(cv::Mat& image, double& timestamp)
+{
+    // Timestamped between grab and decode, so the decoding time does not add jitter
+    const bool grabbed = mCapture.grab();
+    timestamp = mClock.stamp(mCapture);
+    // retrieve decodes into the existing buffer when the size did not change
+    const bool retrieved = grabbed && (mFormat ? mFormat->retrieve(mCapture, image) : mCapture.retrieve(image));
+    if (!retrieved || image.empty()) return false;
+
+    if (mRealtime)
+    {
+        const double position = mCapture.get(CV_CAP_PROP_POS_MSEC) / 1000.0;
+        if (mFirstPosition < 0 || position < mFirstPosition)
+        {
+            mFirstPosition = position;
+            mFirstRead = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_until(mFirstRead + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(position - mFirstPosition)));
+    }
+    return true;
+}
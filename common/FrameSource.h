@@ -0,0 +1,98 @@
+#pragma once
+
+#include <opencv2/highgui/highgui.hpp>
+#include <chrono>
+
+class CaptureFormat;
+
+/** @brief Timestamps grabbed frames in seconds on the steady clock, with sub-millisecond precision.
+ * The clock never goes backwards with adjustments of the system time. When the backend reports
+ * the time of its buffers through CV_CAP_PROP_POS_MSEC, the intervals between frames can be
+ * taken from it instead; the first frame aligns that time base with the steady clock. Either way
+ * the timestamps keep increasing, also when the backend skips reporting a buffer time.
+ */
+class CaptureClock
+{
+public:
+
+    /** @brief CaptureClock
+    * @param start        -- Time the timestamps are relative to
+    * @param use_position -- Whether to use the backend's CV_CAP_PROP_POS_MSEC when it provides one
+    */
+    CaptureClock(const std::chrono::steady_clock::time_point& start, const bool use_position = false);
+
+    /** @brief Stamp returns the timestamp of the frame just grabbed, call it between grab and retrieve
+    */
+    double stamp(cv::VideoCapture& capture);
+
+    /** @brief Now seconds elapsed since the start time
+    */
+    double now() const;
+
+private:
+
+    const std::chrono::steady_clock::time_point mStart;
+    const bool mUsePosition;
+    bool mAligned;
+    double mOffset;
+    double mLastPosition;
+    double mLastTimestamp;
+};
+
+/** @brief Delivers timestamped frames to a CaptureThread or a processing loop, so a live camera and
+ * a recording can feed the same pipeline.
+ */
+class FrameSource
+{
+public:
+
+    virtual ~FrameSource() {}
+
+    /** @brief Read waits for the next frame and decodes it as BGR
+    * @param image     -- Receives the frame, its buffer is reused when the size did not change
+    * @param timestamp -- Receives the time the frame was captured, in seconds
+    * @return false when no frame could be read
+    */
+    virtual bool read(cv::Mat& image, double& timestamp) = 0;
+
+    /** @brief AtEnd tells whether the last failed read was the normal end of the source
+    */
+    virtual bool atEnd() const { return false; }
+};
+
+/** @brief Reads a camera or a video file through a cv::VideoCapture, timestamping each frame
+ * between grab and retrieve so the decoding time does not add jitter.
+ */
+class VideoCaptureSource : public FrameSource
+{
+public:
+
+    /** @brief VideoCaptureSource
+    * @param capture -- Opened and configured capture
+    * @param clock   -- Timestamps the frames
+    */
+    VideoCaptureSource(cv::VideoCapture& capture, const CaptureClock& clock);
+
+    /** @brief SetRealtime paces the reading of a video file to its own timing, from
+    * CV_CAP_PROP_POS_MSEC, instead of reading it as fast as it decodes
+    */
+    void setRealtime(const bool realtime) { mRealtime = realtime; }
+
+    /** @brief SetFormat retrieves the frames through a capture format, e.g. to convert raw YUYV
+    * frames straight into the caller's buffer
+    */
+    void setFormat(CaptureFormat* format) { mFormat = format; }
+
+    bool read(cv::Mat& image, double& timestamp) override;
+
+private:
+
+    cv::VideoCapture& mCapture;
+    CaptureClock mClock;
+    bool mRealtime;
+    CaptureFormat* mFormat;
+
+    // Media time of the first frame and when it was read, when pacing a file
+    double mFirstPosition;
+    std::chrono::steady_clock::time_point mFirstRead;
+};
@@ -0,0 +1,167 @@
+#include "HudPanel.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Longest row text kept without reallocating, values and appearance names are far shorter
+    const size_t ROW_TEXT_CAPACITY = 32;
+
+    bool sameColor(const cv::Scalar& a, const cv::Scalar& b)
+    {
+        return a.val[0] == b.val[0] && a.val[1] == b.val[1] && a.val[2] == b.val[2];
+    }
+}
+
+HudPanel::HudPanel()
+{
+}
+
+void HudPanel::reset(const cv::Rect& bounds, const int rows)
+{
+    mBounds = bounds;
+    mColor.create(bounds.height, bounds.width, CV_8UC3);
+    mAlpha.create(bounds.height, bounds.width, CV_8UC1);
+    mColor.setTo(cv::Scalar::all(0));
+    mAlpha.setTo(cv::Scalar::all(0));
+    mRows.assign(rows, RowState());
+    for (RowState& row : mRows)
+    {
+        // Storing a new text then reuses the buffer, so steady state frames do not allocate
+        row.text.reserve(ROW_TEXT_CAPACITY);
+    }
+    mDirty.clear();
+}
+
+bool HudPanel::empty() const
+{
+    return mAlpha.empty();
+}
+
+bool HudPanel::needsLabel(const int row)
+{
+    if (row < 0 || row >= (int)mRows.size() || mRows[row].labelled) return false;
+    mRows[row].labelled = true;
+    return true;
+}
+
+bool HudPanel::changed(const int row, const int blocks, const cv::Scalar& color)
+{
+    if (row < 0 || row >= (int)mRows.size()) return false;
+    RowState& state = mRows[row];
+    if (state.valid && state.blocks == blocks && sameColor(state.color, color)) return false;
+    state.valid = true;
+    state.blocks = blocks;
+    state.color = color;
+    return true;
+}
+
+bool HudPanel::changed(const int row, const char* text, const cv::Scalar& color)
+{
+    if (row < 0 || row >= (int)mRows.size()) return false;
+    RowState& state = mRows[row];
+    if (state.valid && state.text == text && sameColor(state.color, color)) return false;
+    state.valid = true;
+    state.text = text;
+    state.color = color;
+    return true;
+}
+
+void HudPanel::beginFrame()
+{
+    // Keeps the capacity, so steady state frames do not allocate
+    mDirty.clear();
+}
+
+cv::Rect HudPanel::toLayer(const cv::Rect& rect) const
+{
+    cv::Rect layer_rect(rect.x - mBounds.x, rect.y - mBounds.y, rect.width, rect.height);
+    return layer_rect & cv::Rect(0, 0, mBounds.width, mBounds.height);
+}
+
+void HudPanel::clear(const cv::Rect& rect)
+{
+    const cv::Rect r = toLayer(rect);
+    if (r.area() <= 0) return;
+    mColor(r).setTo(cv::Scalar::all(0));
+    mAlpha(r).setTo(cv::Scalar::all(0));
+    mDirty.push_back(rect);
+}
+
+void HudPanel::fill(const cv::Rect& rect, const cv::Scalar& color, const float alpha)
+{
+    const cv::Rect r = toLayer(rect);
+    if (r.area() <= 0) return;
+    mColor(r).setTo(cv::Scalar(color.val[0] * alpha, color.val[1] * alpha, color.val[2] * alpha));
+    mAlpha(r).setTo(cv::Scalar::all(255 * alpha));
+}
+
+void HudPanel::text(const std::string& str, const cv::Point& org, const cv::Scalar& color, const int thickness)
+{
+    const cv::Point layer_org(org.x - mBounds.x, org.y - mBounds.y);
+    cv::putText(mColor, str, layer_org, cv::FONT_HERSHEY_SIMPLEX, 0.5f, color, thickness);
+    cv::putText(mAlpha, str, layer_org, cv::FONT_HERSHEY_SIMPLEX, 0.5f, cv::Scalar::all(255), thickness);
+}
+
+void HudPanel::line(const cv::Point& from, const cv::Point& to, const cv::Scalar& color, const int thickness)
+{
+    const cv::Point origin(mBounds.x, mBounds.y);
+    cv::line(mColor, from - origin, to - origin, color, thickness);
+    cv::line(mAlpha, from - origin, to - origin, cv::Scalar::all(255), thickness);
+}
+
+void HudPanel::scroll(const cv::Rect& rect, const int pixels)
+{
+    const cv::Rect r = toLayer(rect);
+    if (r.area() <= 0 || pixels <= 0) return;
+
+    const int kept = r.width - pixels;
+    if (kept > 0)
+    {
+        // Source and destination overlap, so the rows are moved rather than copied
+        for (int y = r.y; y < r.y + r.height; ++y)
+        {
+            uchar* color = mColor.ptr<uchar>(y) + 3 * r.x;
+            uchar* alpha = mAlpha.ptr<uchar>(y) + r.x;
+            std::memmove(color, color + 3 * pixels, 3 * kept);
+            std::memmove(alpha, alpha + pixels, kept);
+        }
+    }
+
+    const int cleared = (std::min)(pixels, r.width);
+    clear(cv::Rect(r.x + r.width - cleared + mBounds.x, r.y + mBounds.y, cleared, r.height));
+}
+
+void HudPanel::composite(cv::Mat& img, const cv::Point& anchor) const
+{
+    const cv::Rect target = cv::Rect(anchor.x + mBounds.x, anchor.y + mBounds.y, mBounds.width, mBounds.height)
+                            & cv::Rect(0, 0, img.cols, img.rows);
+    if (target.area() <= 0) return;
+
+    const int offset_x = target.x - (anchor.x + mBounds.x);
+    const int offset_y = target.y - (anchor.y + mBounds.y);
+    for (int y = 0; y < target.height; ++y)
+    {
+        const uchar* alpha = mAlpha.ptr<uchar>(y + offset_y) + offset_x;
+        const uchar* color = mColor.ptr<uchar>(y + offset_y) + 3 * offset_x;
+        uchar* dst = img.ptr<uchar>(y + target.y) + 3 * target.x;
+        for (int x = 0; x < target.width; ++x, dst += 3, color += 3)
+        {
+            const int a = alpha[x];
+            if (a == 0) continue;
+            const int inv = 255 - a;
+            // color is premultiplied, so the sum can never exceed 255
+            dst[0] = (uchar)((dst[0] * inv + 127) / 255 + color[0]);
+            dst[1] = (uchar)((dst[1] * inv + 127) / 255 + color[1]);
+            dst[2] = (uchar)((dst[2] * inv + 127) / 255 + color[2]);
+        }
+    }
+}
+
+void HudPanel::drawDirtyRects(cv::Mat& img, const cv::Point& anchor, const cv::Scalar& color) const
+{
+    for (const cv::Rect& rect : mDirty)
+    {
+        cv::rectangle(img, cv::Rect(rect.x + anchor.x, rect.y + anchor.y, rect.width, rect.height), color, 1);
+    }
+}
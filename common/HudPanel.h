@@ -0,0 +1,105 @@
+#pragma once
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <string>
+#include <vector>
+
+/** @brief Cached HUD layer for one side of a face's metrics.
+ * The layer is stored as premultiplied BGR plus an alpha plane in coordinates relative to
+ * an anchor point, so it can follow the face around the frame without being redrawn.
+ * Rows remember the state they were last drawn with; only rows whose state changed are
+ * cleared and drawn again, everything else is simply composited onto the next frame.
+ */
+class HudPanel
+{
+public:
+
+    HudPanel();
+
+    /** @brief Reset allocates an empty layer
+    * @param bounds -- Area covered by the layer, relative to the anchor point
+    * @param rows   -- Number of rows whose state is tracked
+    */
+    void reset(const cv::Rect& bounds, const int rows);
+
+    bool empty() const;
+
+    /** @brief NeedsLabel returns true the first time it is called for a row, for static content
+    */
+    bool needsLabel(const int row);
+
+    /** @brief Changed compares and stores the state of an equalizer row
+    * @return true if the row has to be redrawn
+    */
+    bool changed(const int row, const int blocks, const cv::Scalar& color);
+
+    /** @brief Changed compares and stores the state of a text row
+    * @return true if the row has to be redrawn
+    */
+    bool changed(const int row, const char* text, const cv::Scalar& color);
+
+    /** @brief BeginFrame forgets the areas redrawn on the previous frame
+    */
+    void beginFrame();
+
+    /** @brief Scratch reusable buffer for composing row text without allocating
+    */
+    std::string& scratch() { return mScratch; }
+
+    /** @brief Clear makes an area of the layer transparent and marks it as redrawn
+    */
+    void clear(const cv::Rect& rect);
+
+    /** @brief Fill blends a solid color over an area with the given opacity
+    */
+    void fill(const cv::Rect& rect, const cv::Scalar& color, const float alpha);
+
+    /** @brief Text draws an opaque string, org is the bottom-left corner of the text
+    */
+    void text(const std::string& str, const cv::Point& org, const cv::Scalar& color, const int thickness);
+
+    /** @brief Line draws an opaque line segment
+    */
+    void line(const cv::Point& from, const cv::Point& to, const cv::Scalar& color, const int thickness = 1);
+
+    /** @brief Scroll shifts an area of the layer to the left and clears the columns uncovered on
+    * its right, so scrolling content only has to draw what is new
+    * @param rect   -- Area to scroll
+    * @param pixels -- Number of columns to shift by
+    */
+    void scroll(const cv::Rect& rect, const int pixels);
+
+    /** @brief Composite blends the layer onto an image
+    * @param img    -- Image to draw on
+    * @param anchor -- Position of the layer's origin in the image
+    */
+    void composite(cv::Mat& img, const cv::Point& anchor) const;
+
+    /** @brief DrawDirtyRects outlines the areas redrawn since the last call to beginFrame
+    */
+    void drawDirtyRects(cv::Mat& img, const cv::Point& anchor, const cv::Scalar& color) const;
+
+    const cv::Rect& getBounds() const { return mBounds; }
+
+private:
+
+    struct RowState
+    {
+        RowState() : valid(false), labelled(false), blocks(0) {}
+
+        bool valid;
+        bool labelled;
+        int blocks;
+        cv::Scalar color;
+        std::string text;
+    };
+
+    cv::Rect toLayer(const cv::Rect& rect) const;
+
+    cv::Rect mBounds;
+    cv::Mat mColor;
+    cv::Mat mAlpha;
+    std::vector<RowState> mRows;
+    std::vector<cv::Rect> mDirty;
+    std::string mScratch;
+};
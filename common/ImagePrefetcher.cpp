@@ -0,0 +1,161 @@
+#include "ImagePrefetcher.h"
+#include <chrono>
+#include <fstream>
+
+#include <opencv2/highgui/highgui.hpp>
+
+namespace
+{
+    /** @brief Hands the same block of memory to every image decoded into a slot, growing it when an
+    * image is larger. A decoder that fails before allocating leaves the image empty, which is how
+    * failures are told apart from the previous content of the slot.
+    */
+    class SlotAllocator : public cv::MatAllocator
+    {
+    public:
+
+        SlotAllocator() : mRefcount(0) {}
+
+        void allocate(int dims, const int* sizes, int type, int*& refcount, uchar*& datastart, uchar*& data,
+                      size_t* step) override
+        {
+            step[dims - 1] = CV_ELEM_SIZE(type);
+            for (int i = dims - 2; i >= 0; i--)
+            {
+                step[i] = step[i + 1] * sizes[i + 1];
+            }
+            const size_t total = step[0] * sizes[0];
+            if (mBlock.size() < total)
+            {
+                mBlock.resize(total);
+            }
+            mRefcount = 1;
+            refcount = &mRefcount;
+            datastart = data = mBlock.data();
+        }
+
+        void deallocate(int* refcount, uchar* datastart, uchar* data) override
+        {
+            // The block is kept for the next image of the slot
+        }
+
+    private:
+
+        std::vector<uchar> mBlock;
+        int mRefcount;
+    };
+}
+
+ImagePrefetcher::ImagePrefetcher(const std::vector<boost::filesystem::path>& files, const int decoders,
+                                 const size_t lookahead)
+    : mFiles(files), mDecoders(std::max(1, decoders)), mSlots(std::max<size_t>(1, lookahead)),
+      mNextDecode(0), mNextOutput(0), mReleasedCount(0), mStopRequested(false), mFailed(0), mWaitTime(0)
+{
+    for (Slot& slot : mSlots)
+    {
+        slot.allocator.reset(new SlotAllocator());
+        slot.image.image.allocator = slot.allocator.get();
+        slot.ready = false;
+    }
+}
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+    stop();
+}
+
+void ImagePrefetcher::start()
+{
+    if (!mThreads.empty()) return;
+    for (int i = 0; i < mDecoders; i++)
+    {
+        mThreads.push_back(std::thread(&ImagePrefetcher::decode, this));
+    }
+}
+
+void ImagePrefetcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mStopRequested = true;
+    }
+    mReleased.notify_all();
+    mDecoded.notify_all();
+    for (auto & thread : mThreads)
+    {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+const PrefetchedImage* ImagePrefetcher::next()
+{
+    const auto started = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mNextOutput >= mFiles.size()) return nullptr;
+
+    Slot& slot = mSlots[mNextOutput % mSlots.size()];
+    mDecoded.wait(lock, [&] { return mStopRequested || (slot.ready && slot.image.index == mNextOutput); });
+    if (mStopRequested) return nullptr;
+
+    mNextOutput++;
+    mWaitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return &slot.image;
+}
+
+void ImagePrefetcher::release(const PrefetchedImage* image)
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mSlots[image->index % mSlots.size()].ready = false;
+        mReleasedCount = image->index + 1;
+    }
+    mReleased.notify_all();
+}
+
+bool ImagePrefetcher::readFile(const boost::filesystem::path& file, std::vector<uchar>& bytes)
+{
+    std::ifstream stream(file.c_str(), std::ios::binary | std::ios::ate);
+    if (!stream.is_open()) return false;
+
+    const std::streamoff size = stream.tellg();
+    if (size <= 0) return false;
+    bytes.resize((size_t)size);
+    stream.seekg(0);
+    return (bool)stream.read((char*)bytes.data(), size);
+}
+
+void ImagePrefetcher::decode()
+{
+    for (;;)
+    {
+        size_t index;
+        {
+            // A slot is free once the image decoded lookahead files earlier has been released
+            std::unique_lock<std::mutex> lock(mMutex);
+            mReleased.wait(lock, [&] {
+                return mStopRequested || mNextDecode >= mFiles.size() || mNextDecode < mReleasedCount + mSlots.size();
+            });
+            if (mStopRequested || mNextDecode >= mFiles.size()) return;
+            index = mNextDecode++;
+        }
+
+        // The slot is only touched by this thread until it is marked ready
+        Slot& slot = mSlots[index % mSlots.size()];
+        slot.image.index = index;
+        slot.image.image.release();
+        if (readFile(mFiles[index], slot.bytes))
+        {
+            cv::imdecode(slot.bytes, CV_LOAD_IMAGE_COLOR, &slot.image.image);
+        }
+        if (slot.image.image.empty())
+        {
+            mFailed++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            slot.ready = true;
+        }
+        mDecoded.notify_all();
+    }
+}
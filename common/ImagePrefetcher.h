@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <opencv2/core/core.hpp>
+
+/** @brief One image of the sequence, owned by the prefetcher until it is released
+ */
+struct PrefetchedImage
+{
+    cv::Mat image;      // Decoded BGR image, empty if the file could not be read or decoded
+    size_t index;       // Position of the file in the sequence
+};
+
+/** @brief Reads and decodes a sequence of image files on several threads ahead of the consumer,
+ * and hands the images out in sequence order.
+ *
+ * Decoders work at most lookahead images ahead of the oldest image not yet released, into a pool
+ * of lookahead slots. Each slot keeps its file buffer and its pixel buffer between uses, so decoding
+ * images no larger than the previous ones allocates nothing once the pool has warmed up. Images are
+ * released in the order they were handed out and must not be referenced after that.
+ */
+class ImagePrefetcher
+{
+public:
+
+    /** @brief ImagePrefetcher
+    * @param files     -- Image files, in output order
+    * @param decoders  -- Number of decoding threads
+    * @param lookahead -- Number of images decoded ahead, and of buffers in the pool
+    */
+    ImagePrefetcher(const std::vector<boost::filesystem::path>& files, const int decoders, const size_t lookahead);
+
+    ~ImagePrefetcher();
+
+    void start();
+
+    void stop();
+
+    /** @brief Next blocks until the next image of the sequence is decoded
+    * @return the image, to be handed back with release, or nullptr after the last one
+    */
+    const PrefetchedImage* next();
+
+    /** @brief Release returns the buffer of an image to the pool
+    */
+    void release(const PrefetchedImage* image);
+
+    unsigned long getFailedCount() const { return mFailed; }
+
+    /** @brief GetWaitTime returns the total time next spent waiting for decoders, in seconds
+    */
+    double getWaitTime() const { return mWaitTime; }
+
+private:
+
+    struct Slot
+    {
+        PrefetchedImage image;
+        std::vector<uchar> bytes;   // Content of the file, reused for the next one
+        std::unique_ptr<cv::MatAllocator> allocator;    // Keeps the pixels of the image between uses
+        bool ready;
+    };
+
+    void decode();
+
+    bool readFile(const boost::filesystem::path& file, std::vector<uchar>& bytes);
+
+    const std::vector<boost::filesystem::path> mFiles;
+    const int mDecoders;
+
+    std::vector<Slot> mSlots;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mDecoded;   // Signaled when a slot becomes ready
+    std::condition_variable mReleased;  // Signaled when a slot can be reused
+    size_t mNextDecode;     // Next file to be claimed by a decoder
+    size_t mNextOutput;     // Next file to be handed out
+    size_t mReleasedCount;  // Files before this one have all been released
+    bool mStopRequested;
+
+    std::atomic<unsigned long> mFailed;
+    double mWaitTime;
+};
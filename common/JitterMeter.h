@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cmath>
+
+/** @brief Statistics of the intervals between consecutive timestamps
+ */
+class JitterMeter
+{
+public:
+
+    JitterMeter() : mCount(0), mLast(0), mMean(0), mM2(0), mMax(0) {}
+
+    /** @brief Add records a timestamp, in seconds
+    */
+    void add(const double timestamp)
+    {
+        if (mCount++ > 0)
+        {
+            // Welford's running mean and variance of the intervals
+            const double interval = timestamp - mLast;
+            const unsigned long n = mCount - 1;
+            const double delta = interval - mMean;
+            mMean += delta / n;
+            mM2 += delta * (interval - mMean);
+            if (interval > mMax) mMax = interval;
+        }
+        mLast = timestamp;
+    }
+
+    unsigned long getCount() const { return mCount; }
+
+    /** @brief GetMeanInterval
+    * @return mean interval in milliseconds
+    */
+    double getMeanInterval() const { return mMean * 1000; }
+
+    /** @brief GetJitter standard deviation of the intervals
+    * @return jitter in milliseconds
+    */
+    double getJitter() const { return mCount > 2 ? std::sqrt(mM2 / (mCount - 2)) * 1000 : 0; }
+
+    /** @brief GetMaxInterval
+    * @return longest interval in milliseconds
+    */
+    double getMaxInterval() const { return mMax * 1000; }
+
+private:
+
+    unsigned long mCount;
+    double mLast;
+    double mMean;
+    double mM2;
+    double mMax;
+};
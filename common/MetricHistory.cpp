@@ -0,0 +1,54 @@
+#include "MetricHistory.h"
+
+MetricHistory::MetricHistory()
+    : mMetrics(0), mNext(0), mSize(0)
+{
+}
+
+void MetricHistory::reset(const size_t metrics, const size_t capacity)
+{
+    mMetrics = metrics;
+    mValues.assign(metrics * capacity, 0.0f);
+    mTimestamps.assign(capacity, 0.0);
+    clear();
+}
+
+void MetricHistory::clear()
+{
+    mNext = 0;
+    mSize = 0;
+}
+
+void MetricHistory::grow(const size_t capacity)
+{
+    if (capacity <= this->capacity()) return;
+
+    // Unrolled oldest first, so the ring starts at slot 0
+    std::vector<float> values(mMetrics * capacity, 0.0f);
+    std::vector<double> timestamps(capacity, 0.0);
+    for (size_t i = 0; i < mSize; i++)
+    {
+        for (size_t metric = 0; metric < mMetrics; metric++)
+        {
+            values[metric * capacity + i] = value(metric, i);
+        }
+        timestamps[i] = timestamp(i);
+    }
+    mValues.swap(values);
+    mTimestamps.swap(timestamps);
+    mNext = mSize % capacity;
+}
+
+void MetricHistory::push(const double timestamp, const float* values)
+{
+    if (mTimestamps.empty()) return;
+
+    const size_t cap = capacity();
+    for (size_t metric = 0; metric < mMetrics; metric++)
+    {
+        mValues[metric * cap + mNext] = values[metric];
+    }
+    mTimestamps[mNext] = timestamp;
+    mNext = (mNext + 1) % cap;
+    if (mSize < cap) mSize++;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/** @brief Fixed capacity time series of a face's metrics.
+ * Samples are stored in a ring: one contiguous float array per metric plus the array of
+ * timestamps, all allocated once. Pushing past the capacity overwrites the oldest sample.
+ */
+class MetricHistory
+{
+public:
+
+    MetricHistory();
+
+    /** @brief Reset allocates the storage and forgets every sample
+    * @param metrics  -- Number of metrics stored per sample
+    * @param capacity -- Maximum number of samples kept
+    */
+    void reset(const size_t metrics, const size_t capacity);
+
+    void clear();
+
+    /** @brief Grow raises the capacity, keeping the samples
+    * @param capacity -- New maximum number of samples, ignored if not larger than the current one
+    */
+    void grow(const size_t capacity);
+
+    /** @brief Push appends a sample
+    * @param timestamp -- Time of the sample in seconds
+    * @param values    -- One value per metric
+    */
+    void push(const double timestamp, const float* values);
+
+    bool empty() const { return mSize == 0; }
+
+    size_t size() const { return mSize; }
+
+    size_t capacity() const { return mTimestamps.size(); }
+
+    size_t metrics() const { return mMetrics; }
+
+    /** @brief Timestamp of a sample, 0 is the oldest and size()-1 the newest
+    */
+    double timestamp(const size_t i) const { return mTimestamps[slot(i)]; }
+
+    /** @brief Value of a metric for a sample, 0 is the oldest and size()-1 the newest
+    */
+    float value(const size_t metric, const size_t i) const { return mValues[metric * capacity() + slot(i)]; }
+
+    /** @brief Series is the raw ring of a metric, capacity() values starting at the slot of
+    * oldest() and wrapping around
+    */
+    const float* series(const size_t metric) const { return &mValues[metric * capacity()]; }
+
+    /** @brief Oldest is the slot of the oldest sample in the raw rings
+    */
+    size_t oldest() const { return slot(0); }
+
+private:
+
+    size_t slot(const size_t i) const { return (mNext + capacity() - mSize + i) % capacity(); }
+
+    size_t mMetrics;
+    size_t mNext;
+    size_t mSize;
+    std::vector<float> mValues;
+    std::vector<double> mTimestamps;
+};
@@ -0,0 +1,214 @@
+#include "MjpegServer.h"
+#include <boost/bind.hpp>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+    const char STREAM_RESPONSE[] =
+        "HTTP/1.0 200 OK\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Pragma: no-cache\r\n"
+        "Connection: close\r\n"
+        "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+        "\r\n";
+
+    const char PART_TRAILER[] = "\r\n";
+
+    // Buffers in flight per viewer (sending + pending) plus the latest frame and one to encode into
+    const size_t JPEG_POOL_SIZE = 4;
+
+    // Wait before accepting again after a failure, e.g. when the process is out of file descriptors
+    const long ACCEPT_RETRY_MS = 500;
+}
+
+MjpegServer::MjpegServer(const unsigned short port, const std::string& host,
+                         const float max_fps, const int quality)
+    : mAcceptor(mService), mAcceptRetry(mService), mPool(std::make_shared<JpegPool>()), mInterval(max_fps > 0 ? 1.0 / max_fps : 0.0),
+      mLastEncodeTs(-1.0), mEncoded(0), mSkipped(0), mViewerCount(0)
+{
+    for (size_t i = 0; i < JPEG_POOL_SIZE; i++)
+    {
+        mPool->buffers.push_back(std::unique_ptr<std::vector<uchar> >(new std::vector<uchar>()));
+        mPool->free.push_back(mPool->buffers.back().get());
+    }
+
+    mEncodeParams.push_back(CV_IMWRITE_JPEG_QUALITY);
+    mEncodeParams.push_back(quality);
+
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(host), port);
+    mAcceptor.open(endpoint.protocol());
+    mAcceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    mAcceptor.bind(endpoint);
+    mAcceptor.listen();
+
+    accept();
+    mThread = std::thread([this] { mService.run(); });
+}
+
+MjpegServer::~MjpegServer()
+{
+    stop();
+}
+
+void MjpegServer::stop()
+{
+    if (!mThread.joinable()) return;
+
+    // The sockets belong to the server thread, they are closed there before it stops
+    mService.post(boost::bind(&MjpegServer::shutdown, this));
+    mThread.join();
+}
+
+void MjpegServer::shutdown()
+{
+    boost::system::error_code ignored;
+    mAcceptor.close(ignored);
+    mAcceptRetry.cancel(ignored);
+    for (const ViewerPtr& viewer : mViewers)
+    {
+        viewer->socket.close(ignored);
+    }
+    mViewers.clear();
+    mViewerCount = 0;
+    mLatest.reset();
+    mService.stop();
+}
+
+void MjpegServer::onFrame(const cv::Mat& frame, const double timestamp)
+{
+    if (mViewerCount == 0) return;
+
+    // Timestamps going backwards mean the source restarted
+    if (mLastEncodeTs >= 0 && timestamp >= mLastEncodeTs && timestamp - mLastEncodeTs < mInterval) return;
+    mLastEncodeTs = timestamp;
+
+    // Reuse a buffer that no viewer holds any more, its capacity is kept across frames
+    std::vector<uchar>* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(mPool->mutex);
+        if (!mPool->free.empty())
+        {
+            buffer = mPool->free.back();
+            mPool->free.pop_back();
+        }
+    }
+    if (buffer == nullptr)
+    {
+        mSkipped++;
+        return;
+    }
+
+    // The mutex orders the last send of the buffer before it is encoded into again
+    std::shared_ptr<JpegPool> pool = mPool;
+    JpegPtr jpeg(buffer, [pool](std::vector<uchar>* released)
+    {
+        std::lock_guard<std::mutex> lg(pool->mutex);
+        pool->free.push_back(released);
+    });
+    if (!cv::imencode(".jpg", frame, *buffer, mEncodeParams)) return;
+    mEncoded++;
+
+    mService.post(boost::bind(&MjpegServer::broadcast, this, jpeg));
+}
+
+void MjpegServer::accept()
+{
+    ViewerPtr viewer = std::make_shared<Viewer>(mService);
+    mAcceptor.async_accept(viewer->socket, [this, viewer](const boost::system::error_code& ec)
+    {
+        if (!mAcceptor.is_open() || ec == boost::asio::error::operation_aborted) return;
+        if (!ec)
+        {
+            boost::asio::async_read_until(viewer->socket, viewer->request, "\r\n\r\n",
+                boost::bind(&MjpegServer::onRequest, this, viewer, boost::asio::placeholders::error));
+            accept();
+            return;
+        }
+
+        // Errors such as running out of file descriptors persist for a while, retrying at once
+        // would keep the server thread busy
+        mAcceptRetry.expires_from_now(boost::posix_time::milliseconds(ACCEPT_RETRY_MS));
+        mAcceptRetry.async_wait([this](const boost::system::error_code& retry_ec)
+        {
+            if (!retry_ec && mAcceptor.is_open()) accept();
+        });
+    });
+}
+
+void MjpegServer::onRequest(ViewerPtr viewer, const boost::system::error_code& ec)
+{
+    if (ec) return;
+
+    // Every path gets the stream, so there is no need to parse the request line
+    boost::asio::async_write(viewer->socket, boost::asio::buffer(STREAM_RESPONSE, sizeof(STREAM_RESPONSE) - 1),
+        boost::bind(&MjpegServer::onResponseSent, this, viewer, boost::asio::placeholders::error));
+}
+
+void MjpegServer::onResponseSent(ViewerPtr viewer, const boost::system::error_code& ec)
+{
+    if (ec) return;
+
+    mViewers.insert(viewer);
+    mViewerCount = mViewers.size();
+    if (mLatest) send(viewer, mLatest);
+}
+
+void MjpegServer::broadcast(JpegPtr jpeg)
+{
+    mLatest = jpeg;
+    for (const ViewerPtr& viewer : mViewers)
+    {
+        if (viewer->writing)
+        {
+            viewer->pending = jpeg;
+        }
+        else
+        {
+            send(viewer, jpeg);
+        }
+    }
+}
+
+void MjpegServer::send(ViewerPtr viewer, JpegPtr jpeg)
+{
+    char header[128];
+    const int length = std::snprintf(header, sizeof(header),
+        "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %lu\r\n\r\n",
+        (unsigned long)jpeg->size());
+    viewer->part_header.assign(header, length);
+    viewer->sending = jpeg;
+    viewer->writing = true;
+
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.push_back(boost::asio::buffer(viewer->part_header));
+    buffers.push_back(boost::asio::buffer(*jpeg));
+    buffers.push_back(boost::asio::buffer(PART_TRAILER, sizeof(PART_TRAILER) - 1));
+    boost::asio::async_write(viewer->socket, buffers,
+        boost::bind(&MjpegServer::onFrameSent, this, viewer, boost::asio::placeholders::error));
+}
+
+void MjpegServer::onFrameSent(ViewerPtr viewer, const boost::system::error_code& ec)
+{
+    viewer->writing = false;
+    viewer->sending.reset();
+    if (ec)
+    {
+        drop(viewer);
+        return;
+    }
+    if (viewer->pending)
+    {
+        JpegPtr next = viewer->pending;
+        viewer->pending.reset();
+        send(viewer, next);
+    }
+}
+
+void MjpegServer::drop(ViewerPtr viewer)
+{
+    boost::system::error_code ignored;
+    viewer->socket.close(ignored);
+    mViewers.erase(viewer);
+    mViewerCount = mViewers.size();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameSink.h"
+
+/** @brief Serves the annotated frames as a multipart MJPEG stream over HTTP.
+ * Each accepted frame is JPEG encoded once into a pooled buffer that is shared by
+ * all connected viewers; viewers that are still busy sending skip to the newest frame.
+ * Encoding is capped at its own rate and skipped entirely while nobody is watching.
+ * A buffer goes back to the pool when the last viewer is done with it; frames arriving while
+ * every buffer is still being sent are skipped. When a connection cannot be accepted, e.g. when
+ * the process is out of file descriptors, accepting resumes after a short pause.
+ *
+ *    curl http://localhost:8080/ --output stream.mjpeg
+ */
+class MjpegServer : public FrameSink
+{
+public:
+
+    /** @brief MjpegServer starts listening immediately
+    * @param port    -- TCP port to listen on
+    * @param host    -- Address to bind, loopback by default
+    * @param max_fps -- Maximum number of frames encoded per second
+    * @param quality -- JPEG quality (0-100)
+    */
+    MjpegServer(const unsigned short port, const std::string& host = "127.0.0.1",
+                const float max_fps = 10, const int quality = 80);
+
+    ~MjpegServer();
+
+    void onFrame(const cv::Mat& frame, const double timestamp) override;
+
+    /** @brief Stop disconnects all viewers and stops the server thread
+    */
+    void stop();
+
+    unsigned long getEncodedCount() const { return mEncoded; }
+
+    /** @brief GetSkippedCount returns the frames skipped because every buffer was still being sent
+    */
+    unsigned long getSkippedCount() const { return mSkipped; }
+
+    size_t getViewerCount() const { return mViewerCount; }
+
+private:
+
+    typedef std::shared_ptr<const std::vector<uchar> > JpegPtr;
+
+    /** @brief Buffers not held by any viewer. Buffers are returned from whichever thread drops
+    * their last reference, so the pool is shared with them and outlives the server if needed.
+    */
+    struct JpegPool
+    {
+        std::mutex mutex;
+        std::vector<std::vector<uchar>*> free;
+        std::vector<std::unique_ptr<std::vector<uchar> > > buffers;
+    };
+
+    struct Viewer
+    {
+        Viewer(boost::asio::io_service& service) : socket(service), writing(false) {}
+
+        boost::asio::ip::tcp::socket socket;
+        boost::asio::streambuf request;
+        std::string part_header;
+        JpegPtr sending;
+        JpegPtr pending;
+        bool writing;
+    };
+    typedef std::shared_ptr<Viewer> ViewerPtr;
+
+    void accept();
+    void shutdown();
+    void onRequest(ViewerPtr viewer, const boost::system::error_code& ec);
+    void onResponseSent(ViewerPtr viewer, const boost::system::error_code& ec);
+    void broadcast(JpegPtr jpeg);
+    void send(ViewerPtr viewer, JpegPtr jpeg);
+    void onFrameSent(ViewerPtr viewer, const boost::system::error_code& ec);
+    void drop(ViewerPtr viewer);
+
+    boost::asio::io_service mService;
+    boost::asio::ip::tcp::acceptor mAcceptor;
+    boost::asio::deadline_timer mAcceptRetry;
+    std::thread mThread;
+
+    // Only touched from the server thread
+    std::set<ViewerPtr> mViewers;
+    JpegPtr mLatest;
+
+    std::shared_ptr<JpegPool> mPool;
+
+    // Only touched from the drawing thread
+    std::vector<int> mEncodeParams;
+    const double mInterval;
+    double mLastEncodeTs;
+
+    std::atomic<unsigned long> mEncoded;
+    std::atomic<unsigned long> mSkipped;
+    std::atomic<size_t> mViewerCount;
+};
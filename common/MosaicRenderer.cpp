@@ -0,0 +1,100 @@
+#include "MosaicRenderer.h"
+#include <boost/thread/locks.hpp>
+#include <cmath>
+
+MosaicRenderer::MosaicRenderer(const size_t streams, const cv::Size& canvas, const float cell_fps,
+                               const std::string& window)
+    : mCanvas(cv::Mat::zeros(canvas, CV_8UC3)),
+      mCellInterval(cell_fps > 0 ? 1.0 / cell_fps : 0.0),
+      mWindow(window),
+      mChanged(false)
+{
+    const int cols = (int)std::ceil(std::sqrt((double)streams));
+    const int rows = cols > 0 ? (int)((streams + cols - 1) / cols) : 0;
+    for (size_t i = 0; i < streams; i++)
+    {
+        const int col = (int)i % cols;
+        const int row = (int)i / cols;
+        // Integer edges so neighbouring cells tile the canvas without gaps
+        const int x0 = col * canvas.width / cols;
+        const int x1 = (col + 1) * canvas.width / cols;
+        const int y0 = row * canvas.height / rows;
+        const int y1 = (row + 1) * canvas.height / rows;
+        mCells.push_back(std::unique_ptr<Cell>(new Cell(*this, cv::Rect(x0, y0, x1 - x0, y1 - y0))));
+    }
+}
+
+FrameSink* MosaicRenderer::stream(const size_t index)
+{
+    return mCells.at(index).get();
+}
+
+void MosaicRenderer::setLabel(const size_t index, const std::string& label)
+{
+    mCells.at(index)->mLabel = label;
+}
+
+bool MosaicRenderer::present()
+{
+    if (!mChanged.exchange(false)) return false;
+    {
+        boost::unique_lock<boost::shared_mutex> lock(mCanvasMutex);
+        cv::imshow(mWindow, mCanvas);
+    }
+    cv::waitKey(1);
+    return true;
+}
+
+unsigned long MosaicRenderer::getDrawnCount(const size_t index) const
+{
+    return mCells.at(index)->mDrawn;
+}
+
+unsigned long MosaicRenderer::getSkippedCount(const size_t index) const
+{
+    return mCells.at(index)->mSkipped;
+}
+
+MosaicRenderer::Cell::Cell(MosaicRenderer& mosaic, const cv::Rect& area)
+    : mMosaic(mosaic), mArea(area), mLastTimestamp(-1.0), mDrawn(0), mSkipped(0)
+{
+}
+
+void MosaicRenderer::Cell::onFrame(const cv::Mat& frame, const double timestamp)
+{
+    if (frame.empty() || mArea.area() <= 0) return;
+
+    // A timestamp going backwards means the stream restarted
+    if (mLastTimestamp >= 0 && timestamp >= mLastTimestamp && timestamp - mLastTimestamp < mMosaic.mCellInterval)
+    {
+        mSkipped++;
+        return;
+    }
+    mLastTimestamp = timestamp;
+
+    boost::shared_lock<boost::shared_mutex> lock(mMosaic.mCanvasMutex);
+    cv::Mat cell = mMosaic.mCanvas(mArea);
+
+    if (frame.size() != mSourceSize)
+    {
+        // Fit the frame in the cell keeping its aspect ratio, the borders stay black
+        mSourceSize = frame.size();
+        const double scale = (std::min)((double)mArea.width / frame.cols, (double)mArea.height / frame.rows);
+        const int width = (std::max)(1, (int)(frame.cols * scale));
+        const int height = (std::max)(1, (int)(frame.rows * scale));
+        mFit = cv::Rect((mArea.width - width) / 2, (mArea.height - height) / 2, width, height);
+        cell.setTo(cv::Scalar::all(0));
+    }
+
+    // The destination already has the requested size and type, so resize writes into the canvas
+    cv::Mat fit = cell(mFit);
+    cv::resize(frame, fit, mFit.size(), 0, 0, cv::INTER_AREA);
+
+    if (!mLabel.empty())
+    {
+        cv::putText(fit, mLabel, cv::Point(8, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5f, cv::Scalar(255, 255, 255), 1);
+    }
+
+    mDrawn++;
+    mMosaic.mChanged = true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameSink.h"
+
+/** @brief Composites the annotated frames of several streams into a single grid window.
+ * Every stream gets its own cell, exposed as a FrameSink to register with that stream's
+ * Visualizer. Frames are resized straight into their cell of the canvas from the stream's
+ * drawing thread, so nothing is copied at full resolution and the streams resize in parallel.
+ * Each cell is refreshed at most at its own rate; the window is presented from one thread.
+ */
+class MosaicRenderer
+{
+public:
+
+    /** @brief MosaicRenderer lays out the grid, as close to square as possible
+    * @param streams  -- Number of cells
+    * @param canvas   -- Size of the mosaic
+    * @param cell_fps -- Maximum number of times per second a cell is refreshed, 0 for no limit
+    * @param window   -- Name of the window the mosaic is shown in
+    */
+    MosaicRenderer(const size_t streams, const cv::Size& canvas = cv::Size(1920, 1080),
+                   const float cell_fps = 15, const std::string& window = "mosaic");
+
+    /** @brief Stream returns the sink feeding a cell, owned by the renderer
+    * @param index -- Index of the cell, in row major order
+    */
+    FrameSink* stream(const size_t index);
+
+    /** @brief SetLabel sets the caption drawn in the corner of a cell
+    */
+    void setLabel(const size_t index, const std::string& label);
+
+    /** @brief Present shows the mosaic if any cell changed since the last call.
+    * Has to be called from the thread owning the highgui windows.
+    * @return true if the window was refreshed
+    */
+    bool present();
+
+    /** @brief GetDrawnCount number of frames resized into a cell
+    */
+    unsigned long getDrawnCount(const size_t index) const;
+
+    /** @brief GetSkippedCount number of frames skipped by the rate limit of a cell
+    */
+    unsigned long getSkippedCount(const size_t index) const;
+
+    size_t getStreamCount() const { return mCells.size(); }
+
+private:
+
+    class Cell : public FrameSink
+    {
+    public:
+
+        Cell(MosaicRenderer& mosaic, const cv::Rect& area);
+
+        void onFrame(const cv::Mat& frame, const double timestamp) override;
+
+        MosaicRenderer& mMosaic;
+        const cv::Rect mArea;
+        cv::Rect mFit;
+        cv::Size mSourceSize;
+        std::string mLabel;
+        double mLastTimestamp;
+        std::atomic<unsigned long> mDrawn;
+        std::atomic<unsigned long> mSkipped;
+    };
+
+    cv::Mat mCanvas;
+    const double mCellInterval;
+    const std::string mWindow;
+    std::vector<std::unique_ptr<Cell> > mCells;
+
+    // Cells never overlap, so they draw concurrently under a shared lock; presenting
+    // needs the whole canvas to be stable and takes it exclusively
+    boost::shared_mutex mCanvasMutex;
+    std::atomic<bool> mChanged;
+};
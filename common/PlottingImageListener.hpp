@@ -7,10 +7,13 @@
 #include <thread>
 #include <mutex>
 #include <fstream>
+#include <iomanip>
 #include <boost/filesystem.hpp>
 #include <boost/timer/timer.hpp>
 
 #include "Visualizer.h"
+#include "FaceGeometry.h"
+#include "RateController.h"
 #include "ImageListener.h"
 
 using namespace affdex;
@@ -28,55 +31,104 @@ class PlottingImageListener : public ImageListener
     std::ofstream &fStream;
     std::chrono::time_point<std::chrono::system_clock> mStartT;
     const bool mDrawDisplay;
+    bool mDrawLandmarks;
+    RateController* mRateController;
+    float mDetectScale;
     const int spacing = 20;
     const float font_size = 0.5f;
     const int font = cv::FONT_HERSHEY_COMPLEX_SMALL;
     Visualizer viz;
+    std::vector<std::vector<cv::Point2f> > mBoundingBoxes;
+    // Names of the emojis seen so far, so writing a row does not build a new string per face
+    std::map<affdex::Emoji, std::string> mEmojiNames;
 
 public:
 
 
     PlottingImageListener(std::ofstream &csv, const bool draw_display)
-        : fStream(csv), mDrawDisplay(draw_display), mStartT(std::chrono::system_clock::now()),
+        : fStream(csv), mDrawDisplay(draw_display), mDrawLandmarks(false), mRateController(nullptr), mDetectScale(1.0f),
+        mStartT(std::chrono::system_clock::now()),
         mCaptureLastTS(-1.0f), mCaptureFPS(-1.0f),
         mProcessLastTS(-1.0f), mProcessFPS(-1.0f)
     {
+        // A stream opened later, e.g. once per file, gets its header from writeHeader
+        if (fStream.is_open()) writeHeader();
+        viz.setShowWindow(mDrawDisplay);
+    }
 
+    /** @brief WriteHeader starts a CSV file with the column names, for a stream (re)opened after construction
+    */
+    void writeHeader()
+    {
         fStream << "TimeStamp,faceId,interocularDistance,glasses,age,ethnicity,gender,dominantEmoji,";
-        for (std::string angle : viz.HEAD_ANGLES) fStream << angle << ",";
-        for (std::string emotion : viz.EMOTIONS) fStream << emotion << ",";
-        for (std::string expression : viz.EXPRESSIONS) fStream << expression << ",";
-        for (std::string emoji : viz.EMOJIS) fStream << emoji << ",";
+        for (const std::string& angle : viz.HEAD_ANGLES) fStream << angle << ",";
+        for (const std::string& emotion : viz.EMOTIONS) fStream << emotion << ",";
+        for (const std::string& expression : viz.EXPRESSIONS) fStream << expression << ",";
+        for (const std::string& emoji : viz.EMOJIS) fStream << emoji << ",";
         fStream << std::endl;
         fStream.precision(4);
         fStream << std::fixed;
     }
 
-    cv::Point2f minPoint(VecFeaturePoint points)
+    cv::Point2f minPoint(const VecFeaturePoint& points)
     {
-        VecFeaturePoint::iterator it = points.begin();
-        FeaturePoint ret = *it;
-        for (; it != points.end(); it++)
-        {
-            if (it->x < ret.x) ret.x = it->x;
-            if (it->y < ret.y) ret.y = it->y;
-        }
-        return cv::Point2f(ret.x, ret.y);
+        return computeFaceGeometry(points).top_left;
     };
 
-    cv::Point2f maxPoint(VecFeaturePoint points)
+    cv::Point2f maxPoint(const VecFeaturePoint& points)
     {
-        VecFeaturePoint::iterator it = points.begin();
-        FeaturePoint ret = *it;
-        for (; it != points.end(); it++)
-        {
-            if (it->x > ret.x) ret.x = it->x;
-            if (it->y > ret.y) ret.y = it->y;
-        }
-        return cv::Point2f(ret.x, ret.y);
+        return computeFaceGeometry(points).bottom_right;
     };
 
 
+    void setDisplayPolicy(const float max_fps, const float scale)
+    {
+        viz.setDisplayPolicy(max_fps, scale);
+    }
+
+    void setDrawLandmarks(const bool draw_landmarks)
+    {
+        mDrawLandmarks = draw_landmarks;
+    }
+
+    /** @brief SetRateController reports the arrival of every result to a rate controller
+    */
+    void setRateController(RateController* controller)
+    {
+        mRateController = controller;
+    }
+
+    /** @brief SetDetectScale brings the results of frames downscaled before detection back to full resolution
+    * @param scale -- Scale the frames were resized by
+    */
+    void setDetectScale(const float scale)
+    {
+        mDetectScale = scale;
+    }
+
+    void setHudDebug(const bool debug)
+    {
+        viz.setHudDebug(debug);
+    }
+
+    void setSparklines(const std::vector<std::string>& metrics, const float seconds)
+    {
+        viz.setSparklines(metrics, seconds);
+    }
+
+    void addFrameSink(FrameSink* sink)
+    {
+        viz.addFrameSink(sink);
+    }
+
+    /** @brief IsRendering
+     * @return true if frames need to be drawn, either on screen or for a frame sink
+     */
+    bool isRendering() const
+    {
+        return mDrawDisplay || viz.hasFrameSinks();
+    }
+
     double getProcessingFrameRate()
     {
         std::lock_guard<std::mutex> lg(mMutex);
@@ -106,6 +158,23 @@ public:
 
     void onImageResults(std::map<FaceId, Face> faces, Frame image) override
     {
+        if (mRateController)
+        {
+            mRateController->onResult(image.getTimestamp());
+        }
+        if (mDetectScale != 1.0f)
+        {
+            const float inverse = 1.0f / mDetectScale;
+            for (auto & face_id_pair : faces)
+            {
+                for (FeaturePoint& point : face_id_pair.second.featurePoints)
+                {
+                    point.x *= inverse;
+                    point.y *= inverse;
+                }
+                face_id_pair.second.measurements.interocularDistance *= inverse;
+            }
+        }
         std::lock_guard<std::mutex> lg(mMutex);
         mDataArray.push_back(std::pair<Frame, std::map<FaceId, Face>>(image, faces));
         std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
@@ -122,53 +191,54 @@ public:
         mCaptureLastTS = image.getTimestamp();
     };
 
-    void outputToFile(const std::map<FaceId, Face> faces, const double timeStamp)
+    void outputToFile(const std::map<FaceId, Face>& faces, const double timeStamp)
     {
         if (faces.empty())
         {
-            fStream << timeStamp << ",nan,nan,no,unknown,unknown,unknown,unknown,";
-            for (std::string angle : viz.HEAD_ANGLES) fStream << "nan,";
-            for (std::string emotion : viz.EMOTIONS) fStream << "nan,";
-            for (std::string expression : viz.EXPRESSIONS) fStream << "nan,";
-            for (std::string emoji : viz.EMOJIS) fStream << "nan,";
+            // Timestamps keep microseconds, the metrics four decimals
+            fStream << std::setprecision(6) << timeStamp << std::setprecision(4) << ",nan,nan,no,unknown,unknown,unknown,unknown,";
+            for (size_t i = 0; i < viz.HEAD_ANGLES.size(); i++) fStream << "nan,";
+            for (size_t i = 0; i < viz.EMOTIONS.size(); i++) fStream << "nan,";
+            for (size_t i = 0; i < viz.EXPRESSIONS.size(); i++) fStream << "nan,";
+            for (size_t i = 0; i < viz.EMOJIS.size(); i++) fStream << "nan,";
             fStream << std::endl;
         }
         for (auto & face_id_pair : faces)
         {
-            Face f = face_id_pair.second;
+            const Face& f = face_id_pair.second;
 
-            fStream << timeStamp << ","
+            fStream << std::setprecision(6) << timeStamp << std::setprecision(4) << ","
                 << f.id << ","
                 << f.measurements.interocularDistance << ","
                 << viz.GLASSES_MAP[f.appearance.glasses] << ","
                 << viz.AGE_MAP[f.appearance.age] << ","
                 << viz.ETHNICITY_MAP[f.appearance.ethnicity] << ","
                 << viz.GENDER_MAP[f.appearance.gender] << ","
-                << affdex::EmojiToString(f.emojis.dominantEmoji) << ",";
+                << emojiName(f.emojis.dominantEmoji) << ",";
 
-            float *values = (float *)&f.measurements.orientation;
-            for (std::string angle : viz.HEAD_ANGLES)
+            const float *values = (const float *)&f.measurements.orientation;
+            for (size_t i = 0; i < viz.HEAD_ANGLES.size(); i++)
             {
                 fStream << (*values) << ",";
                 values++;
             }
 
-            values = (float *)&f.emotions;
-            for (std::string emotion : viz.EMOTIONS)
+            values = (const float *)&f.emotions;
+            for (size_t i = 0; i < viz.EMOTIONS.size(); i++)
             {
                 fStream << (*values) << ",";
                 values++;
             }
 
-            values = (float *)&f.expressions;
-            for (std::string expression : viz.EXPRESSIONS)
+            values = (const float *)&f.expressions;
+            for (size_t i = 0; i < viz.EXPRESSIONS.size(); i++)
             {
                 fStream << (*values) << ",";
                 values++;
             }
 
-            values = (float *)&f.emojis;
-            for (std::string emoji : viz.EMOJIS)
+            values = (const float *)&f.emojis;
+            for (size_t i = 0; i < viz.EMOJIS.size(); i++)
             {
                 fStream << (*values) << ",";
                 values++;
@@ -178,28 +248,30 @@ public:
         }
     }
 
-    std::vector<cv::Point2f> CalculateBoundingBox(VecFeaturePoint points)
+    const std::string& emojiName(const affdex::Emoji emoji)
     {
+        std::map<affdex::Emoji, std::string>::iterator it = mEmojiNames.find(emoji);
+        if (it == mEmojiNames.end()) it = mEmojiNames.insert(std::make_pair(emoji, affdex::EmojiToString(emoji))).first;
+        return it->second;
+    }
 
-        std::vector<cv::Point2f> ret;
-
-        //Top Left
-        ret.push_back(minPoint(points));
-
-        //Bottom Right
-        ret.push_back(maxPoint(points));
-
-        //Top Right
-        ret.push_back(cv::Point2f(ret[1].x,
-                                  ret[0].y));
-        //Bottom Left
-        ret.push_back(cv::Point2f(ret[0].x,
-                                  ret[1].y));
+    std::vector<cv::Point2f> CalculateBoundingBox(const VecFeaturePoint& points)
+    {
 
+        std::vector<cv::Point2f> ret;
+        CalculateBoundingBox(points, ret);
         return ret;
     }
 
-    void draw(const std::map<FaceId, Face> faces, Frame image)
+    /** @brief CalculateBoundingBox fills the corners in place, so a reused vector never reallocates
+    */
+    void CalculateBoundingBox(const VecFeaturePoint& points, std::vector<cv::Point2f>& ret)
+    {
+        // Single pass over the points for both corners
+        boundingBoxCorners(computeFaceGeometry(points), ret);
+    }
+
+    void draw(const std::map<FaceId, Face>& faces, Frame image)
     {
 
         const int left_margin = 30;
@@ -207,26 +279,30 @@ public:
         cv::Scalar clr = cv::Scalar(0, 0, 255);
         cv::Scalar header_clr = cv::Scalar(255, 0, 0);
 
+        // Frames skipped by the display policy are never converted or drawn
+        if (!viz.shouldRender(image.getTimestamp())) return;
+
         std::shared_ptr<unsigned char> imgdata = image.getBGRByteArray();
         cv::Mat img = cv::Mat(image.getHeight(), image.getWidth(), CV_8UC3, imgdata.get());
         viz.updateImage(img);
 
+        // The boxes are only ever grown, so the inner vectors keep their storage between frames
+        if (mBoundingBoxes.size() < faces.size()) mBoundingBoxes.resize(faces.size());
+        size_t i = 0;
         for (auto & face_id_pair : faces)
         {
-            Face f = face_id_pair.second;
-            VecFeaturePoint points = f.featurePoints;
-            std::vector<cv::Point2f> bounding_box = CalculateBoundingBox(points);
-
-            // Draw Facial Landmarks Points
-            //viz.drawPoints(points);
-
-            // Draw bounding box
-            viz.drawBoundingBox(bounding_box[0], bounding_box[1], f.emotions.valence);
+            CalculateBoundingBox(face_id_pair.second.featurePoints, mBoundingBoxes[i++]);
+        }
 
-            // Draw a face on screen
-            viz.drawFaceMetrics(f, bounding_box);
+        // Draw Facial Landmarks Points of all the faces at once
+        if (mDrawLandmarks)
+        {
+            viz.drawPoints(faces);
         }
 
+        // Draw the bounding boxes and metrics of all the faces, rendered in parallel
+        viz.drawFaces(faces, mBoundingBoxes);
+
         viz.showImage();
         std::lock_guard<std::mutex> lg(mMutex);
     }
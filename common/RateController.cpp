@@ -0,0 +1,126 @@
+#include "RateController.h"
+#include <algorithm>
+
+namespace
+{
+    // Weight of the newest measurement in the smoothed rate and latency
+    const double SMOOTHING = 0.2;
+    // A frame without a result after this many target latencies was dropped by the detector
+    const double PENDING_TIMEOUT_LATENCIES = 4.0;
+}
+
+RateController::RateController(const CaptureClock& clock, const double target_latency, const float max_fps,
+                               const size_t max_in_flight)
+    : mClock(clock), mTargetLatency(target_latency),
+      mMinInterval(max_fps > 0 ? 1.0 / max_fps : 0.0), mMaxInterval(2.0),
+      mMaxInFlight((std::max)(max_in_flight, (size_t)1)), mPendingTimeout(PENDING_TIMEOUT_LATENCIES * target_latency),
+      mInterval(mMinInterval), mLastSubmit(-1), mRate(0), mLatency(0), mSubmitted(0), mSkipped(0), mExpired(0)
+{
+}
+
+bool RateController::shouldSubmit(const double timestamp)
+{
+    const double now = mClock.now();
+
+    std::lock_guard<std::mutex> lg(mMutex);
+    const bool restarted = timestamp < mLastSubmit;
+    if (restarted) mInFlight.clear();
+
+    // Results that never came would otherwise hold back every frame from now on
+    bool expired = false;
+    while (!mInFlight.empty() && now - mInFlight.front().second > mPendingTimeout)
+    {
+        mInFlight.pop_front();
+        mExpired++;
+        expired = true;
+    }
+    if (expired)
+    {
+        // Treated as a late result
+        mInterval = (std::min)((std::max)(mInterval, 0.01) * 1.25, mMaxInterval);
+    }
+
+    if (!restarted && (mInFlight.size() >= mMaxInFlight ||
+                       (mLastSubmit >= 0 && timestamp - mLastSubmit < mInterval)))
+    {
+        mSkipped++;
+        return false;
+    }
+
+    if (mLastSubmit >= 0 && !restarted && timestamp > mLastSubmit)
+    {
+        const double rate = 1.0 / (timestamp - mLastSubmit);
+        mRate = mSubmitted > 1 ? mRate + SMOOTHING * (rate - mRate) : rate;
+    }
+    mLastSubmit = timestamp;
+    // Frame timestamps come back from the SDK as floats, the frame is known by the float it is given
+    mInFlight.push_back(std::make_pair((double)(float)timestamp, now));
+    mSubmitted++;
+    return true;
+}
+
+void RateController::onResult(const double timestamp)
+{
+    const double now = mClock.now();
+
+    std::lock_guard<std::mutex> lg(mMutex);
+    // Frames submitted before this one were either processed or dropped by the detector
+    const double key = (double)(float)timestamp;
+    double submitted = -1;
+    while (!mInFlight.empty() && mInFlight.front().first <= key)
+    {
+        if (mInFlight.front().first == key) submitted = mInFlight.front().second;
+        mInFlight.pop_front();
+    }
+    // Results of frames already expired, or of another run, say nothing about the latency
+    if (submitted < 0) return;
+    const double latency = now - submitted;
+
+    mLatency = mLatency > 0 ? mLatency + SMOOTHING * (latency - mLatency) : latency;
+
+    // Back off quickly when late, speed up slowly when there is headroom
+    if (mLatency > mTargetLatency)
+    {
+        mInterval = (std::min)((std::max)(mInterval, 0.01) * 1.25, mMaxInterval);
+    }
+    else if (mLatency < 0.8 * mTargetLatency)
+    {
+        mInterval = (std::max)(mInterval * 0.95, mMinInterval);
+    }
+}
+
+double RateController::getRate()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mRate;
+}
+
+double RateController::getLatency()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mLatency * 1000;
+}
+
+size_t RateController::getInFlight()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mInFlight.size();
+}
+
+unsigned long RateController::getSubmittedCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mSubmitted;
+}
+
+unsigned long RateController::getSkippedCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mSkipped;
+}
+
+unsigned long RateController::getExpiredCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mExpired;
+}
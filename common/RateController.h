@@ -0,0 +1,84 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#include "FrameSource.h"
+
+/** @brief Decides which captured frames are submitted to the detector so that results keep
+ * arriving within a target latency. When the detector falls behind, for instance because the CPU
+ * is shared with other services, the submission interval grows; when it catches up, it shrinks
+ * back towards the requested processing rate. Frames are also held back while too many are
+ * already waiting inside the detector.
+ *
+ * The latency is measured from submission to result on the controller's own clock, so it holds
+ * whatever the frame timestamps are relative to, e.g. when replaying a recording. A frame whose
+ * result never comes, dropped by the detector, is forgotten after a few times the target latency.
+ *
+ * shouldSubmit is called from the capture loop and onResult from the detector's callback thread.
+ */
+class RateController
+{
+public:
+
+    /** @brief RateController
+    * @param clock          -- Clock the submissions and results are timed on
+    * @param target_latency -- Latency to hold, from submission to result, in seconds
+    * @param max_fps        -- Highest submission rate
+    * @param max_in_flight  -- Maximum number of frames submitted without a result yet
+    */
+    RateController(const CaptureClock& clock, const double target_latency, const float max_fps,
+                   const size_t max_in_flight);
+
+    /** @brief ShouldSubmit decides whether a captured frame is handed to the detector, and records it if so
+    * @param timestamp -- Timestamp of the frame
+    */
+    bool shouldSubmit(const double timestamp);
+
+    /** @brief OnResult records the arrival of a result and adapts the submission interval
+    * @param timestamp -- Timestamp of the processed frame
+    */
+    void onResult(const double timestamp);
+
+    /** @brief GetRate smoothed number of frames submitted per second
+    */
+    double getRate();
+
+    /** @brief GetLatency smoothed time from submission to result
+    * @return latency in milliseconds
+    */
+    double getLatency();
+
+    /** @brief GetInFlight number of submitted frames without a result yet
+    */
+    size_t getInFlight();
+
+    unsigned long getSubmittedCount();
+
+    unsigned long getSkippedCount();
+
+    /** @brief GetExpiredCount number of submitted frames forgotten without a result
+    */
+    unsigned long getExpiredCount();
+
+private:
+
+    const CaptureClock& mClock;
+    const double mTargetLatency;
+    const double mMinInterval;
+    const double mMaxInterval;
+    const size_t mMaxInFlight;
+    const double mPendingTimeout;
+
+    std::mutex mMutex;
+    // Timestamp of each frame without a result yet, as the float the SDK reports, and when it was submitted, oldest first
+    std::deque<std::pair<double, double> > mInFlight;
+    double mInterval;
+    double mLastSubmit;
+    double mRate;
+    double mLatency;
+    unsigned long mSubmitted;
+    unsigned long mSkipped;
+    unsigned long mExpired;
+};
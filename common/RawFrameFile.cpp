@@ -0,0 +1,208 @@
+#include "RawFrameFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+namespace bip = boost::interprocess;
+
+namespace
+{
+    const char RAW_MAGIC[8] = { 'A', 'F', 'X', 'R', 'A', 'W', '0', '1' };
+
+    // Records start after the header, aligned for the timestamps
+    const size_t DATA_OFFSET = 64;
+
+    // Records the file starts with unless told otherwise, a few hundred MB for VGA frames; it
+    // doubles each time it is full, so a long recording only grows a few times
+    const size_t GROW_FRAMES = 256;
+
+    struct RawFrameHeader
+    {
+        char magic[8];
+        uint32_t width;
+        uint32_t height;
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t record_size;
+        uint64_t count;
+    };
+}
+
+RawFrameRecorder::RawFrameRecorder(FrameSource& source, const std::string& path, const size_t reserve_frames)
+    : mSource(source), mPath(path), mReserve(reserve_frames), mType(0), mRecordSize(0), mCapacity(0), mCount(0),
+      mFailed(false), mFirstTimestamp(0), mLastTimestamp(0), mGrown(false), mGrowCount(0), mStallTime(0),
+      mStalledFrames(0)
+{
+}
+
+RawFrameRecorder::~RawFrameRecorder()
+{
+    close();
+}
+
+bool RawFrameRecorder::read(cv::Mat& image, double& timestamp)
+{
+    if (!mSource.read(image, timestamp)) return false;
+    write(image, timestamp);
+    return true;
+}
+
+bool RawFrameRecorder::resize(const size_t capacity)
+{
+    try
+    {
+        // Windows cannot resize a file while it is mapped
+        bip::mapped_region().swap(mRegion);
+        bip::file_mapping().swap(mFile);
+        boost::filesystem::resize_file(mPath, DATA_OFFSET + capacity * mRecordSize);
+        if (capacity == 0) return true;
+
+        bip::file_mapping(mPath.c_str(), bip::read_write).swap(mFile);
+        bip::mapped_region(mFile, bip::read_write).swap(mRegion);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Raw recording to " << mPath << " stopped: " << e.what() << std::endl;
+        return false;
+    }
+    mCapacity = capacity;
+    return true;
+}
+
+void RawFrameRecorder::write(const cv::Mat& image, const double timestamp)
+{
+    if (mFailed) return;
+
+    if (mCapacity == 0)
+    {
+        mSize = image.size();
+        mType = image.type();
+        mRecordSize = (sizeof(double) + image.total() * image.elemSize() + 7) & ~(size_t)7;
+        if (!std::ofstream(mPath.c_str(), std::ios::binary | std::ios::trunc) || !resize(std::max(GROW_FRAMES, mReserve)))
+        {
+            std::cerr << "Unable to record raw frames to " << mPath << std::endl;
+            mFailed = true;
+            return;
+        }
+
+        RawFrameHeader* header = static_cast<RawFrameHeader*>(mRegion.get_address());
+        std::memset(header, 0, DATA_OFFSET);
+        std::memcpy(header->magic, RAW_MAGIC, sizeof(RAW_MAGIC));
+        header->width = (uint32_t)mSize.width;
+        header->height = (uint32_t)mSize.height;
+        header->type = (uint32_t)mType;
+        header->record_size = mRecordSize;
+    }
+    if (image.size() != mSize || image.type() != mType)
+    {
+        std::cerr << "Raw recording to " << mPath << " stopped: the frame size changed" << std::endl;
+        mFailed = true;
+        return;
+    }
+    if (mGrown)
+    {
+        // The source went on while the file grew: frames a camera delivered meanwhile were lost,
+        // estimated from the gap to the previous frame at the mean interval so far
+        mGrown = false;
+        const double interval = mCount > 1 ? (mLastTimestamp - mFirstTimestamp) / (mCount - 1) : 0;
+        const long missed = interval > 0 ? (long)std::floor((timestamp - mLastTimestamp) / interval + 0.5) - 1 : 0;
+        if (missed > 0) mStalledFrames += missed;
+    }
+    if (mCount == mCapacity)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        if (!resize(2 * mCapacity))
+        {
+            mFailed = true;
+            return;
+        }
+        mStallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        mGrowCount++;
+        mGrown = true;
+    }
+
+    char* record = static_cast<char*>(mRegion.get_address()) + DATA_OFFSET + mCount * mRecordSize;
+    std::memcpy(record, &timestamp, sizeof(double));
+    const size_t row_size = mSize.width * image.elemSize();
+    for (int row = 0; row < mSize.height; row++)
+    {
+        std::memcpy(record + sizeof(double) + row * row_size, image.ptr(row), row_size);
+    }
+
+    // Counted once the frame is complete, so a recording cut short stays readable
+    if (mCount == 0) mFirstTimestamp = timestamp;
+    mLastTimestamp = timestamp;
+    mCount++;
+    static_cast<RawFrameHeader*>(mRegion.get_address())->count = mCount;
+}
+
+void RawFrameRecorder::close()
+{
+    if (mCapacity == 0) return;
+    mRegion.flush();
+    resize(mCount);
+    mCapacity = 0;
+}
+
+RawFrameReplay::RawFrameReplay(const std::string& path, const double speed)
+    : mSpeed(speed), mOpened(false), mType(0), mRecordSize(0), mCount(0), mNext(0), mFirstTimestamp(0)
+{
+    try
+    {
+        bip::file_mapping(path.c_str(), bip::read_only).swap(mFile);
+        bip::mapped_region(mFile, bip::copy_on_write).swap(mRegion);
+    }
+    catch (bip::interprocess_exception& e)
+    {
+        std::cerr << "Unable to map " << path << ": " << e.what() << std::endl;
+        return;
+    }
+
+    const RawFrameHeader* header = static_cast<const RawFrameHeader*>(mRegion.get_address());
+    if (mRegion.get_size() < DATA_OFFSET || std::memcmp(header->magic, RAW_MAGIC, sizeof(RAW_MAGIC)) != 0)
+    {
+        std::cerr << path << " is not a raw frame recording" << std::endl;
+        return;
+    }
+
+    mSize = cv::Size((int)header->width, (int)header->height);
+    mType = (int)header->type;
+    mRecordSize = (size_t)header->record_size;
+    mCount = (unsigned long)header->count;
+    if (mSize.width <= 0 || mSize.height <= 0 || mRecordSize < sizeof(double) + (size_t)mSize.area() * CV_ELEM_SIZE(mType) ||
+        mRegion.get_size() < DATA_OFFSET + mCount * mRecordSize)
+    {
+        std::cerr << path << " is truncated or corrupt" << std::endl;
+        mCount = 0;
+        return;
+    }
+    mOpened = true;
+}
+
+bool RawFrameReplay::read(cv::Mat& image, double& timestamp)
+{
+    if (!mOpened || mNext >= mCount) return false;
+
+    char* record = static_cast<char*>(mRegion.get_address()) + DATA_OFFSET + mNext * mRecordSize;
+    std::memcpy(&timestamp, record, sizeof(double));
+    image = cv::Mat(mSize.height, mSize.width, mType, record + sizeof(double));
+
+    if (mSpeed > 0)
+    {
+        if (mNext == 0)
+        {
+            mFirstTimestamp = timestamp;
+            mFirstRead = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_until(mFirstRead + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((timestamp - mFirstTimestamp) / mSpeed)));
+    }
+    mNext++;
+    return true;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <opencv2/core/core.hpp>
+
+#include "FrameSource.h"
+
+/** @brief Records the frames read from another source, with their timestamps, to a raw file for
+ * RawFrameReplay. Frames are passed on unchanged.
+ *
+ * The file is a 64 byte header (magic, width, height, OpenCV type, record size, frame count)
+ * followed by fixed size records: the timestamp as a double, then the pixels row after row. It is
+ * memory mapped, so recording a frame is a copy into the page cache. The file doubles in size when
+ * it is full, which holds up the source while it is remapped; room for a whole recording can be
+ * reserved up front instead. The frame count is updated after every frame, so a recording cut short
+ * stays readable; the unused end is trimmed when the recorder is destroyed.
+ *
+ * All frames must have the size and type of the first one, recording stops otherwise.
+ */
+class RawFrameRecorder : public FrameSource
+{
+public:
+
+    /** @brief RawFrameRecorder
+    * @param source         -- Source of the frames, read from the thread calling read
+    * @param path           -- File to create, overwritten if it exists
+    * @param reserve_frames -- Frames the file has room for from the start, 0 for a default of a few hundred
+    */
+    RawFrameRecorder(FrameSource& source, const std::string& path, const size_t reserve_frames = 0);
+
+    ~RawFrameRecorder();
+
+    bool read(cv::Mat& image, double& timestamp) override;
+
+    bool atEnd() const override { return mSource.atEnd(); }
+
+    /** @brief GetRecordedCount returns the number of frames written, once reading has stopped
+    */
+    unsigned long getRecordedCount() const { return mCount; }
+
+    /** @brief GetGrowCount returns the number of times the file was full and had to grow
+    */
+    unsigned long getGrowCount() const { return mGrowCount; }
+
+    /** @brief GetStallTime returns the time reading was held up growing the file, in seconds
+    */
+    double getStallTime() const { return mStallTime; }
+
+    /** @brief GetStalledCount returns an estimate of the frames the source delivered while the file
+    * grew and that were lost, from the gaps in the timestamps. Only a live source loses frames.
+    */
+    unsigned long getStalledCount() const { return mStalledFrames; }
+
+private:
+
+    void write(const cv::Mat& image, const double timestamp);
+
+    bool resize(const size_t capacity);
+
+    void close();
+
+    FrameSource& mSource;
+    const std::string mPath;
+    const size_t mReserve;
+
+    boost::interprocess::file_mapping mFile;
+    boost::interprocess::mapped_region mRegion;
+
+    cv::Size mSize;
+    int mType;
+    size_t mRecordSize;
+    size_t mCapacity;       // Records the file has room for
+    unsigned long mCount;
+    bool mFailed;
+
+    // Timestamps of the frames recorded, for the mean interval
+    double mFirstTimestamp;
+    double mLastTimestamp;
+    bool mGrown;            // The file grew before the last frame
+    unsigned long mGrowCount;
+    double mStallTime;
+    unsigned long mStalledFrames;
+};
+
+/** @brief Reads back a file written by RawFrameRecorder, so the pipeline can be run on the same
+ * frames and timestamps again without a camera.
+ *
+ * Frames are paced by their recorded timestamps, at the recorded rate or faster, or handed out as
+ * fast as they are read. They keep their recorded timestamps at any rate, so the detector sees the
+ * same timing. The file is mapped copy on write and the frames point into the mapping: reading a
+ * frame copies nothing, and drawing on it only copies the pages touched.
+ */
+class RawFrameReplay : public FrameSource
+{
+public:
+
+    /** @brief RawFrameReplay
+    * @param path  -- File written by RawFrameRecorder
+    * @param speed -- Rate relative to the recording, e.g. 1 for the recorded rate or 4 for four
+    *                 times faster, 0 for no pacing at all
+    */
+    RawFrameReplay(const std::string& path, const double speed = 1.0);
+
+    bool isOpened() const { return mOpened; }
+
+    unsigned long getFrameCount() const { return mCount; }
+
+    /** @brief GetReplayedCount returns the number of frames read so far
+    */
+    unsigned long getReplayedCount() const { return mNext; }
+
+    const cv::Size& getSize() const { return mSize; }
+
+    /** @brief Read hands out the next frame once its time has come
+    * @param image     -- Receives a frame pointing into the mapped file, valid while the replay exists
+    * @param timestamp -- Receives the recorded timestamp
+    */
+    bool read(cv::Mat& image, double& timestamp) override;
+
+    bool atEnd() const override { return mOpened && mNext >= mCount; }
+
+private:
+
+    const double mSpeed;
+
+    boost::interprocess::file_mapping mFile;
+    boost::interprocess::mapped_region mRegion;
+
+    bool mOpened;
+    cv::Size mSize;
+    int mType;
+    size_t mRecordSize;
+    unsigned long mCount;
+    unsigned long mNext;
+
+    // Recorded time of the first frame and when it was read, when pacing
+    double mFirstTimestamp;
+    std::chrono::steady_clock::time_point mFirstRead;
+};
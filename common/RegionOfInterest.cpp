@@ -0,0 +1,109 @@
+#include "RegionOfInterest.h"
+#include <algorithm>
+
+#include "FaceGeometry.h"
+
+namespace
+{
+    // Crops whose result never comes back, because the detector skipped them, are forgotten past this
+    const size_t MAX_PENDING_CROPS = 256;
+}
+
+RegionOfInterest::RegionOfInterest(const cv::Rect& bounds, const bool automatic, const float margin, const double hold)
+    : mBounds(bounds), mAutomatic(automatic), mMargin(margin), mHold(hold), mLastFaceTime(0), mCropped(0), mCopied(0),
+      mUnmapped(0)
+{
+}
+
+cv::Rect RegionOfInterest::bounds() const
+{
+    const cv::Rect frame(0, 0, mFrameSize.width, mFrameSize.height);
+    return mBounds.area() > 0 ? (mBounds & frame) : frame;
+}
+
+const cv::Mat& RegionOfInterest::crop(const cv::Mat& frame, const double timestamp)
+{
+    if (frame.size() != mFrameSize)
+    {
+        mFrameSize = frame.size();
+        mRegion = bounds();
+    }
+
+    // Whole rows of a continuous frame are contiguous, anything narrower has to be copied
+    if (mRegion.x == 0 && mRegion.width == frame.cols && frame.isContinuous())
+    {
+        mCrop = frame.rowRange(mRegion.y, mRegion.y + mRegion.height);
+    }
+    else
+    {
+        frame(mRegion).copyTo(mBuffer);
+        mCrop = mBuffer;
+        mCopied++;
+    }
+    mCropped++;
+
+    mOrigins.push_back(std::make_pair((float)timestamp, mRegion.tl()));
+    if (mOrigins.size() > MAX_PENDING_CROPS) mOrigins.pop_front();
+    return mCrop;
+}
+
+bool RegionOfInterest::mapBack(std::map<affdex::FaceId, affdex::Face>& faces, const double timestamp)
+{
+    // Results come back in order, the crops before this one were skipped by the detector
+    const float key = (float)timestamp;
+    auto match = std::find_if(mOrigins.begin(), mOrigins.end(),
+                              [&](const std::pair<float, cv::Point>& crop) { return crop.first == key; });
+    if (match == mOrigins.end())
+    {
+        // Forgotten, or not a crop of this region: its faces cannot be placed in the frame
+        while (!mOrigins.empty() && mOrigins.front().first < key) mOrigins.pop_front();
+        mUnmapped++;
+        return false;
+    }
+
+    const cv::Point origin = match->second;
+    mOrigins.erase(mOrigins.begin(), match + 1);
+
+    cv::Point2f top_left, bottom_right;
+    bool found = false;
+    for (auto & face_id_pair : faces)
+    {
+        for (affdex::FeaturePoint& point : face_id_pair.second.featurePoints)
+        {
+            point.x += origin.x;
+            point.y += origin.y;
+        }
+
+        const FaceGeometry geometry = computeFaceGeometry(face_id_pair.second.featurePoints);
+        if (geometry.count == 0) continue;
+        top_left = found ? cv::Point2f(std::min(top_left.x, geometry.top_left.x), std::min(top_left.y, geometry.top_left.y))
+                         : geometry.top_left;
+        bottom_right = found ? cv::Point2f(std::max(bottom_right.x, geometry.bottom_right.x), std::max(bottom_right.y, geometry.bottom_right.y))
+                             : geometry.bottom_right;
+        found = true;
+    }
+
+    if (!mAutomatic) return true;
+    if (!found)
+    {
+        // Look at the whole bounds again once the faces are gone
+        if (timestamp - mLastFaceTime > mHold) mRegion = bounds();
+        return true;
+    }
+    mLastFaceTime = timestamp;
+
+    // Every change of region moves the faces under the detector's tracker, so the region only
+    // changes when the faces come close to its edges or it has become much larger than needed
+    const float width = bottom_right.x - top_left.x;
+    const float height = bottom_right.y - top_left.y;
+    const float margin = mMargin * std::max(width, height);
+    const cv::Rect wanted = cv::Rect((int)(top_left.x - margin), (int)(top_left.y - margin),
+                                     (int)(width + 2 * margin), (int)(height + 2 * margin)) & bounds();
+    const cv::Rect needed = cv::Rect((int)(top_left.x - margin / 2), (int)(top_left.y - margin / 2),
+                                     (int)(width + margin), (int)(height + margin)) & bounds();
+    if (wanted.area() > 0 && ((needed & mRegion) != needed || mRegion.area() > 4 * wanted.area()))
+    {
+        mRegion = wanted;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <deque>
+#include <map>
+
+#include <opencv2/core/core.hpp>
+#include <Face.h>
+
+/** @brief Restricts detection to the part of the frame where faces are expected, and moves the
+ * results back to full frame coordinates.
+ *
+ * The region is either fixed, or follows the faces: it is set around their bounding boxes with a
+ * margin, kept while they stay well inside it, and reset to the whole bounds when no face was seen
+ * for a while so new faces can be found. A region spanning whole rows is handed to the detector
+ * without a copy; any other region is copied into a reused buffer, as a Frame needs contiguous pixels.
+ *
+ * Crop and mapBack are called from the thread that feeds the detector and handles its results.
+ */
+class RegionOfInterest
+{
+public:
+
+    /** @brief RegionOfInterest
+    * @param bounds    -- Part of the frame to analyze, empty for the whole frame
+    * @param automatic -- Follow the faces within the bounds
+    * @param margin    -- Space kept around the faces on each side, relative to the size of their bounding box
+    * @param hold      -- Seconds without faces before a followed region goes back to the whole bounds
+    */
+    RegionOfInterest(const cv::Rect& bounds, const bool automatic, const float margin = 0.5f, const double hold = 1.0);
+
+    /** @brief Crop returns the part of the frame to hand to the detector and remembers its position
+    * @param frame     -- Captured frame
+    * @param timestamp -- Timestamp the frame is submitted with
+    * @return the region, valid until the next call or until the frame changes
+    */
+    const cv::Mat& crop(const cv::Mat& frame, const double timestamp);
+
+    /** @brief MapBack moves the landmarks of a result to full frame coordinates, and lets a followed
+    * region adjust to the faces
+    * @param faces     -- Faces of the result, modified in place
+    * @param timestamp -- Timestamp of the result
+    * @return false, leaving the faces untouched, when the crop of the result is not known any more;
+    *         the result has to be skipped
+    */
+    bool mapBack(std::map<affdex::FaceId, affdex::Face>& faces, const double timestamp);
+
+    const cv::Rect& getRegion() const { return mRegion; }
+
+    unsigned long getCroppedCount() const { return mCropped; }
+
+    /** @brief GetCopiedCount returns the number of crops that could not be handed over without a copy
+    */
+    unsigned long getCopiedCount() const { return mCopied; }
+
+    /** @brief GetUnmappedCount returns the number of results whose crop was not known, and skipped
+    */
+    unsigned long getUnmappedCount() const { return mUnmapped; }
+
+private:
+
+    cv::Rect bounds() const;
+
+    const cv::Rect mBounds;
+    const bool mAutomatic;
+    const float mMargin;
+    const double mHold;
+
+    cv::Size mFrameSize;
+    cv::Rect mRegion;
+    cv::Mat mCrop;
+    cv::Mat mBuffer;
+    std::deque<std::pair<float, cv::Point> > mOrigins;   // Position of the crops waiting for their result
+    double mLastFaceTime;
+
+    unsigned long mCropped;
+    unsigned long mCopied;
+    unsigned long mUnmapped;
+};
@@ -0,0 +1,361 @@
+#include "SegmentedVideoProcessor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <thread>
+#include <tuple>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include "VideoDecoder.h"
+#include "FrameDetector.h"
+#include "AffdexException.h"
+
+namespace
+{
+    // Results carry the timestamp of their frame as a float
+    const double TIMESTAMP_TOLERANCE = 1e-3;
+
+    /** @brief Collects the results of one segment's detector until the segment thread picks them up
+    */
+    class SegmentListener : public affdex::ImageListener
+    {
+    public:
+
+        void onImageResults(std::map<affdex::FaceId, affdex::Face> faces, affdex::Frame image) override
+        {
+            const double timestamp = image.getTimestamp();
+            {
+                std::lock_guard<std::mutex> lg(mMutex);
+                mPending.push_back(std::make_pair(timestamp, std::move(faces)));
+                // Frames submitted before this one were either processed or dropped by the detector
+                while (!mInFlight.empty() && mInFlight.front() <= timestamp + TIMESTAMP_TOLERANCE)
+                {
+                    mInFlight.pop_front();
+                }
+            }
+            mChanged.notify_all();
+        }
+
+        void onImageCapture(affdex::Frame image) override {}
+
+        /** @brief Submitted records a frame about to be passed to the detector
+        * @param timestamp -- Timestamp of the affdex::Frame, as the detector will report it
+        */
+        void submitted(const double timestamp)
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            mInFlight.push_back(timestamp);
+        }
+
+        /** @brief WaitFor blocks until at most count submitted frames are without a result. A result
+        * also accounts for the frames submitted before it, so frames the detector drops are not
+        * waited for once a later one returns; the last frames may have none, so waiting also ends
+        * once no result arrived for stall.
+        */
+        void waitFor(const size_t count, const std::chrono::milliseconds stall)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (mInFlight.size() > count)
+            {
+                const size_t in_flight = mInFlight.size();
+                if (!mChanged.wait_for(lock, stall, [&] { return mInFlight.size() != in_flight; })) break;
+            }
+        }
+
+        template <typename Consumer>
+        void drain(Consumer consumer)
+        {
+            std::deque<std::pair<double, std::map<affdex::FaceId, affdex::Face> > > pending;
+            {
+                std::lock_guard<std::mutex> lg(mMutex);
+                pending.swap(mPending);
+            }
+            for (auto & result : pending)
+            {
+                consumer(result.first, result.second);
+            }
+        }
+
+    private:
+
+        std::mutex mMutex;
+        std::condition_variable mChanged;
+        std::deque<std::pair<double, std::map<affdex::FaceId, affdex::Face> > > mPending;
+        std::deque<double> mInFlight;   // Timestamps of the frames without a result yet, oldest first
+    };
+
+    // Mean overlap of a face in the warm-up with a face of the previous segment to be taken for the same face
+    const float MIN_MATCH_IOU = 0.5f;
+}
+
+SegmentedVideoProcessor::SegmentedVideoProcessor(const std::string& video, const affdex::path& data_folder,
+                                                 const int process_framerate, const unsigned int faces,
+                                                 const int face_mode, const int segments, const double overlap,
+                                                 const int buffer_length)
+    : mVideo(video), mDataFolder(data_folder), mProcessFramerate(process_framerate), mFaces(faces),
+      mFaceMode(face_mode), mOverlap(overlap), mBufferLength(buffer_length),
+      mDuration(0), mVideoFramerate(0), mStopRequested(false), mNextId(0), mResults(0), mMatched(0)
+{
+    cv::VideoCapture capture(mVideo);
+    if (!capture.isOpened())
+    {
+        throw affdex::AffdexException("Unable to open video file " + mVideo);
+    }
+    mVideoFramerate = capture.get(CV_CAP_PROP_FPS);
+    const double frames = capture.get(CV_CAP_PROP_FRAME_COUNT);
+    if (mVideoFramerate > 0 && frames > 0)
+    {
+        mDuration = frames / mVideoFramerate;
+    }
+
+    // Segments much shorter than their warm-up would spend most of their time warming up
+    int count = std::max(1, segments);
+    if (mDuration <= 0)
+    {
+        count = 1;
+    }
+    else if (mOverlap > 0)
+    {
+        count = std::min(count, std::max(1, (int)(mDuration / (2 * mOverlap))));
+    }
+
+    const double length = mDuration / count;
+    for (int i = 0; i < count; i++)
+    {
+        std::unique_ptr<Segment> segment(new Segment());
+        segment->index = i;
+        segment->begin = i * length;
+        segment->warmup = std::max(0.0, segment->begin - mOverlap);
+        // The container's duration is an estimate, the last segment reads to the end of the file
+        segment->end = i + 1 < count ? (i + 1) * length : std::numeric_limits<double>::infinity();
+        segment->done = false;
+        mSegments.push_back(std::move(segment));
+    }
+}
+
+SegmentedVideoProcessor::~SegmentedVideoProcessor()
+{
+}
+
+float SegmentedVideoProcessor::intersectionOverUnion(const FaceGeometry& a, const FaceGeometry& b)
+{
+    const float width = std::min(a.bottom_right.x, b.bottom_right.x) - std::max(a.top_left.x, b.top_left.x);
+    const float height = std::min(a.bottom_right.y, b.bottom_right.y) - std::max(a.top_left.y, b.top_left.y);
+    if (width <= 0 || height <= 0) return 0;
+
+    const float intersection = width * height;
+    const float area_a = (a.bottom_right.x - a.top_left.x) * (a.bottom_right.y - a.top_left.y);
+    const float area_b = (b.bottom_right.x - b.top_left.x) * (b.bottom_right.y - b.top_left.y);
+    return intersection / (area_a + area_b - intersection);
+}
+
+void SegmentedVideoProcessor::process(const ResultCallback& callback)
+{
+    std::vector<std::thread> threads;
+    for (auto & segment : mSegments)
+    {
+        threads.push_back(std::thread(&SegmentedVideoProcessor::run, this, std::ref(*segment)));
+    }
+
+    std::exception_ptr error;
+    Segment* previous = nullptr;
+    for (auto & segment : mSegments)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDone.wait(lock, [&] { return segment->done; });
+        }
+        if (!error && segment->error)
+        {
+            // The later segments could not be merged anyway
+            error = segment->error;
+            mStopRequested = true;
+        }
+        if (!error)
+        {
+            reconcile(previous, *segment);
+            output(*segment, callback);
+        }
+        if (previous)
+        {
+            std::vector<Boxes>().swap(previous->tail_boxes);
+            previous->ids.clear();
+        }
+        previous = segment.get();
+    }
+
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void SegmentedVideoProcessor::run(Segment& segment)
+{
+    try
+    {
+        // Frames are picked on a grid of the processing rate anchored at the start of the video,
+        // so both segments of an overlap analyze the same frames
+        VideoDecoder decoder(mVideo, (float)mProcessFramerate, mBufferLength, segment.warmup, segment.end);
+        if (!decoder.start())
+        {
+            throw affdex::AffdexException("Unable to open video file " + mVideo);
+        }
+
+        // Frames are picked here, the detector's own rate limit must not drop any of them
+        const float detector_framerate = 2 * (float)std::max<double>(mProcessFramerate, mVideoFramerate);
+        SegmentListener listener;
+        affdex::FrameDetector detector(mBufferLength, detector_framerate, mFaces, (affdex::FaceDetectorMode) mFaceMode);
+        detector.setClassifierPath(mDataFolder);
+        detector.setDetectAllEmotions(true);
+        detector.setDetectAllExpressions(true);
+        detector.setDetectAllEmojis(true);
+        detector.setDetectAllAppearances(true);
+        detector.setImageListener(&listener);
+        detector.start();
+
+        const bool has_next = segment.end < std::numeric_limits<double>::infinity();
+        auto keep = [&](const double timestamp, std::map<affdex::FaceId, affdex::Face>& faces)
+        {
+            if (timestamp < segment.begin || (has_next && timestamp >= segment.end - mOverlap))
+            {
+                Boxes boxes;
+                boxes.timestamp = timestamp;
+                for (auto & face_id_pair : faces)
+                {
+                    const FaceGeometry geometry = computeFaceGeometry(face_id_pair.second.featurePoints);
+                    if (geometry.count > 0) boxes.faces[face_id_pair.first] = geometry;
+                }
+                (timestamp < segment.begin ? segment.warmup_boxes : segment.tail_boxes).push_back(std::move(boxes));
+            }
+            if (timestamp >= segment.begin && timestamp < segment.end)
+            {
+                // The landmarks are not output, dropping them keeps long segments small
+                for (auto & face_id_pair : faces)
+                {
+                    affdex::VecFeaturePoint().swap(face_id_pair.second.featurePoints);
+                }
+                Result result;
+                result.timestamp = timestamp;
+                result.faces.swap(faces);
+                segment.results.push_back(std::move(result));
+            }
+        };
+
+        const std::chrono::milliseconds stall(2000);
+        while (!mStopRequested)
+        {
+            const DecodedFrame* decoded = decoder.acquire();
+            if (decoded == nullptr) break;
+
+            // Offline there is no reason to drop frames, wait for room in the detector's buffer instead
+            listener.waitFor(std::max(0, mBufferLength - 1), stall);
+            affdex::Frame frame(decoded->image.cols, decoded->image.rows, decoded->image.data,
+                                affdex::Frame::COLOR_FORMAT::BGR, (float)decoded->timestamp);
+            listener.submitted(frame.getTimestamp());
+            detector.process(frame);
+            decoder.release(decoded);
+            listener.drain(keep);
+        }
+        decoder.stop();
+        listener.waitFor(0, stall);
+        detector.stop();
+        listener.drain(keep);
+
+        auto earlier = [](const Boxes& a, const Boxes& b) { return a.timestamp < b.timestamp; };
+        std::stable_sort(segment.warmup_boxes.begin(), segment.warmup_boxes.end(), earlier);
+        std::stable_sort(segment.tail_boxes.begin(), segment.tail_boxes.end(), earlier);
+        std::stable_sort(segment.results.begin(), segment.results.end(),
+                         [](const Result& a, const Result& b) { return a.timestamp < b.timestamp; });
+    }
+    catch (...)
+    {
+        segment.error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        segment.done = true;
+    }
+    mDone.notify_all();
+}
+
+void SegmentedVideoProcessor::reconcile(const Segment* previous, Segment& segment)
+{
+    if (previous == nullptr || previous->tail_boxes.empty()) return;
+
+    // Sum of the overlaps of each pair of faces, and number of warm-up frames of each face of this segment
+    std::map<std::pair<affdex::FaceId, affdex::FaceId>, float> overlaps;
+    std::map<affdex::FaceId, int> frames;
+    const double tolerance = 0.5 / mProcessFramerate;
+    for (const Boxes& warmup : segment.warmup_boxes)
+    {
+        auto tail = std::lower_bound(previous->tail_boxes.begin(), previous->tail_boxes.end(), warmup.timestamp - tolerance,
+                                     [](const Boxes& boxes, const double timestamp) { return boxes.timestamp < timestamp; });
+        if (tail == previous->tail_boxes.end() || tail->timestamp > warmup.timestamp + tolerance) continue;
+
+        for (auto & face : warmup.faces)
+        {
+            frames[face.first]++;
+            for (auto & previous_face : tail->faces)
+            {
+                const float iou = intersectionOverUnion(face.second, previous_face.second);
+                if (iou > 0) overlaps[std::make_pair(face.first, previous_face.first)] += iou;
+            }
+        }
+    }
+
+    // Best pairs first, each face is matched at most once on either side
+    std::vector<std::tuple<float, affdex::FaceId, affdex::FaceId> > candidates;
+    for (auto & overlap : overlaps)
+    {
+        const float mean = overlap.second / frames[overlap.first.first];
+        if (mean >= MIN_MATCH_IOU) candidates.push_back(std::make_tuple(mean, overlap.first.first, overlap.first.second));
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::tuple<float, affdex::FaceId, affdex::FaceId>& a,
+                 const std::tuple<float, affdex::FaceId, affdex::FaceId>& b) { return std::get<0>(a) > std::get<0>(b); });
+
+    std::map<affdex::FaceId, bool> taken;
+    for (auto & candidate : candidates)
+    {
+        const affdex::FaceId local = std::get<1>(candidate);
+        const auto previous_id = previous->ids.find(std::get<2>(candidate));
+        if (segment.ids.count(local) || previous_id == previous->ids.end() || taken[previous_id->second]) continue;
+
+        segment.ids[local] = previous_id->second;
+        taken[previous_id->second] = true;
+        mMatched++;
+    }
+}
+
+void SegmentedVideoProcessor::output(Segment& segment, const ResultCallback& callback)
+{
+    std::map<affdex::FaceId, affdex::Face> faces;
+    for (Result& result : segment.results)
+    {
+        faces.clear();
+        for (auto & face_id_pair : result.faces)
+        {
+            auto id = segment.ids.find(face_id_pair.first);
+            if (id == segment.ids.end())
+            {
+                id = segment.ids.insert(std::make_pair(face_id_pair.first, mNextId++)).first;
+            }
+            affdex::Face& face = faces[id->second];
+            face = face_id_pair.second;
+            face.id = id->second;
+        }
+        callback(faces, result.timestamp);
+        mResults++;
+    }
+    std::vector<Result>().swap(segment.results);
+    std::vector<Boxes>().swap(segment.warmup_boxes);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Face.h>
+#include <Frame.h>
+
+#include "FaceGeometry.h"
+
+/** @brief Processes a long video as several time segments in parallel, one FrameDetector each,
+ * and hands the results back in timestamp order as if the video had been processed in one pass.
+ *
+ * Every segment but the first starts decoding a little before its start time so the detector has
+ * found and tracked the faces by the time its own results begin. The results of that warm-up are
+ * not output; they are compared with the end of the previous segment, and faces whose bounding boxes
+ * overlap there keep the id they had in the previous segment. Faces first seen in a segment get new ids.
+ *
+ * A segment is merged as soon as it and all the earlier ones are complete. Until then its results are
+ * held in memory without their landmark points; only bounding boxes are kept near its boundaries.
+ */
+class SegmentedVideoProcessor
+{
+public:
+
+    /** @brief Called from the thread calling process, in timestamp order
+    * @param faces     -- Faces found in the frame, keyed and identified by their reconciled ids
+    * @param timestamp -- Position of the frame in the video, in seconds
+    */
+    typedef std::function<void(const std::map<affdex::FaceId, affdex::Face>& faces, const double timestamp)> ResultCallback;
+
+    /** @brief SegmentedVideoProcessor
+    * @param video             -- Video file to process
+    * @param data_folder       -- Classifier data folder
+    * @param process_framerate -- Frames per second of video submitted to the detectors
+    * @param faces             -- Maximum number of faces tracked
+    * @param face_mode         -- Face detector mode
+    * @param segments          -- Number of segments, and of detectors run at the same time
+    * @param overlap           -- Seconds of video decoded before each segment to warm its detector up
+    * @param buffer_length     -- Frames submitted to each detector before waiting for its results
+    */
+    SegmentedVideoProcessor(const std::string& video, const affdex::path& data_folder, const int process_framerate,
+                            const unsigned int faces, const int face_mode, const int segments,
+                            const double overlap, const int buffer_length);
+
+    ~SegmentedVideoProcessor();
+
+    /** @brief Process runs the segments and blocks until all their results have been handed to the callback.
+    * Errors of a segment are rethrown here once the earlier segments are merged.
+    * @param callback -- Receives the merged results
+    */
+    void process(const ResultCallback& callback);
+
+    /** @brief GetDuration returns the length of the video, in seconds, as reported by its container
+    */
+    double getDuration() const { return mDuration; }
+
+    /** @brief GetSegmentCount returns the number of segments used, fewer than requested for short videos
+    */
+    int getSegmentCount() const { return (int)mSegments.size(); }
+
+    unsigned long getResultCount() const { return mResults; }
+
+    /** @brief GetMatchedCount returns the number of faces that kept their id across a segment boundary
+    */
+    unsigned long getMatchedCount() const { return mMatched; }
+
+    /** @brief IntersectionOverUnion compares two bounding boxes, 0 when they are disjoint, 1 when identical
+    */
+    static float intersectionOverUnion(const FaceGeometry& a, const FaceGeometry& b);
+
+private:
+
+    struct Result
+    {
+        double timestamp;
+        std::map<affdex::FaceId, affdex::Face> faces;
+    };
+
+    struct Boxes
+    {
+        double timestamp;
+        std::map<affdex::FaceId, FaceGeometry> faces;
+    };
+
+    struct Segment
+    {
+        int index;
+        double warmup;          // Decoding starts here
+        double begin;           // Results are output from here
+        double end;             // up to here, excluded
+        std::vector<Boxes> warmup_boxes;
+        std::vector<Result> results;
+        std::vector<Boxes> tail_boxes;  // Last results, compared with the warm-up of the next segment
+        std::map<affdex::FaceId, affdex::FaceId> ids;   // Local id to reconciled id
+        std::exception_ptr error;
+        bool done;
+    };
+
+    void run(Segment& segment);
+
+    void reconcile(const Segment* previous, Segment& segment);
+
+    void output(Segment& segment, const ResultCallback& callback);
+
+    const std::string mVideo;
+    const affdex::path mDataFolder;
+    const int mProcessFramerate;
+    const unsigned int mFaces;
+    const int mFaceMode;
+    const double mOverlap;
+    const int mBufferLength;
+
+    double mDuration;
+    double mVideoFramerate;
+    std::vector<std::unique_ptr<Segment> > mSegments;
+    std::atomic<bool> mStopRequested;
+
+    std::mutex mMutex;
+    std::condition_variable mDone;
+
+    affdex::FaceId mNextId;
+    unsigned long mResults;
+    unsigned long mMatched;
+};
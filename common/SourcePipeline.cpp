@@ -0,0 +1,185 @@
+#include "SourcePipeline.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+#include "AFaceListener.hpp"
+#include "PlottingImageListener.hpp"
+#include "StatusListener.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+SourcePipeline::SourcePipeline(const int id, const std::string& source, const PipelineConfig& config,
+                               const std::chrono::steady_clock::time_point& start, const ResultCallback& callback,
+                               FrameSink* sink, const int cpu)
+    : mId(id), mSource(source), mConfig(config), mStart(start), mCallback(callback), mSink(sink), mCpu(cpu),
+      mStopRequested(false), mRunning(false), mCaptured(0), mResults(0), mDropped(0)
+{
+}
+
+SourcePipeline::~SourcePipeline()
+{
+    stop();
+}
+
+void SourcePipeline::start()
+{
+    if (mThread.joinable()) return;
+    mRunning = true;
+    mThread = std::thread(&SourcePipeline::run, this);
+}
+
+void SourcePipeline::stop()
+{
+    mStopRequested = true;
+    if (mThread.joinable()) mThread.join();
+}
+
+bool SourcePipeline::pinCurrentThread(const int cpu)
+{
+    if (cpu < 0) return false;
+#ifdef _WIN32
+    return cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
+void SourcePipeline::run()
+{
+    const std::string tag = "[source " + std::to_string(mId) + "] ";
+    if (mCpu >= 0 && !pinCurrentThread(mCpu))
+    {
+        std::cerr << tag << "Unable to pin to CPU " << mCpu << std::endl;
+    }
+
+    try
+    {
+        const bool is_camera = !mSource.empty() &&
+            std::all_of(mSource.begin(), mSource.end(), [](const unsigned char c) { return std::isdigit(c) != 0; });
+        cv::VideoCapture capture;
+        if (is_camera)
+        {
+            capture.open(std::stoi(mSource));
+            capture.set(CV_CAP_PROP_FPS, mConfig.camera_framerate);
+            capture.set(CV_CAP_PROP_FRAME_WIDTH, mConfig.resolution[0]);
+            capture.set(CV_CAP_PROP_FRAME_HEIGHT, mConfig.resolution[1]);
+        }
+        else
+        {
+            capture.open(mSource);
+        }
+        if (!capture.isOpened())
+        {
+            std::cerr << tag << "Error opening " << mSource << std::endl;
+            mRunning = false;
+            return;
+        }
+
+        // Every source writes its own CSV file, named after its id
+        const std::string csv_path = "source" + std::to_string(mId) + ".csv";
+        std::ofstream csv(csv_path.c_str());
+        if (!csv.is_open())
+        {
+            std::cerr << tag << "Unable to open csv file " << csv_path << std::endl;
+            mRunning = false;
+            return;
+        }
+        AFaceListener face_listener;
+        StatusListener status_listener;
+        PlottingImageListener listener(csv, false);
+        listener.setDisplayPolicy(mConfig.display_fps, mConfig.display_scale);
+        listener.setDrawLandmarks(mConfig.draw_landmarks);
+        listener.setHudDebug(mConfig.hud_debug);
+        listener.setSparklines(mConfig.sparklines, mConfig.sparkline_seconds);
+        if (mSink) listener.addFrameSink(mSink);
+
+        affdex::FrameDetector detector(mConfig.buffer_length, mConfig.process_framerate, mConfig.faces,
+                                       (affdex::FaceDetectorMode) mConfig.face_mode);
+        detector.setClassifierPath(mConfig.data_folder);
+        detector.setDetectAllEmotions(true);
+        detector.setDetectAllExpressions(true);
+        detector.setDetectAllEmojis(true);
+        detector.setDetectAllAppearances(true);
+        detector.setImageListener(&listener);
+        detector.setFaceListener(&face_listener);
+        detector.setProcessStatusListener(&status_listener);
+        detector.start();
+
+        // Files are read at their own pace and timestamped with their media time
+        VideoCaptureSource source(capture, CaptureClock(mStart, mConfig.capture_position || !is_camera));
+        source.setRealtime(!is_camera);
+        CaptureThread capture_thread(source, mConfig.capture_ring);
+        capture_thread.start();
+
+        // Timestamps as the detector reports them, which tell when every submitted frame is done
+        double last_submitted = -1;
+        double last_result = -1;
+        auto drain = [&]()
+        {
+            while (listener.getDataSize() > 0)
+            {
+                std::pair<affdex::Frame, std::map<affdex::FaceId, affdex::Face> > data_point = listener.getData();
+                const double timestamp = data_point.first.getTimestamp();
+                mResults++;
+                last_result = timestamp;
+                listener.outputToFile(data_point.second, timestamp);
+                mCallback(mId, data_point.second, timestamp);
+                if (listener.isRendering())
+                {
+                    listener.draw(data_point.second, data_point.first);
+                }
+            }
+        };
+
+        while (!mStopRequested && status_listener.isRunning())
+        {
+            const CapturedFrame* captured = capture_thread.acquire();
+            if (captured == nullptr) break;
+
+            affdex::Frame frame(captured->image.cols, captured->image.rows, captured->image.data,
+                                affdex::Frame::COLOR_FORMAT::BGR, captured->timestamp);
+            detector.process(frame);
+            last_submitted = frame.getTimestamp();
+            capture_thread.release(captured);
+            mCaptured++;
+
+            drain();
+        }
+
+        capture_thread.stop();
+        mDropped = capture_thread.getDroppedCount();
+
+        // The frames still in the detector are finished before it stops, up to the result of the
+        // last one; a frame the detector dropped has no result, hence the time limit
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (last_result < last_submitted && status_listener.isRunning() && std::chrono::steady_clock::now() < deadline)
+        {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        detector.stop();
+        drain();
+        csv.close();
+    }
+    catch (affdex::AffdexException& ex)
+    {
+        std::cerr << tag << "Encountered an AffdexException " << ex.what() << std::endl;
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << tag << "Encountered an exception " << ex.what() << std::endl;
+    }
+    mRunning = false;
+}
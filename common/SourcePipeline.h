@@ -0,0 +1,113 @@
+#pragma once
+
+#include <FrameDetector.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureThread.h"
+#include "FrameSink.h"
+
+/** @brief Settings shared by all the pipelines of a multi-source run
+ */
+struct PipelineConfig
+{
+    affdex::path data_folder;
+    int process_framerate;
+    int camera_framerate;
+    int buffer_length;
+    unsigned int faces;
+    int face_mode;
+    std::vector<int> resolution;
+    size_t capture_ring;
+    bool capture_position;
+    float display_fps;
+    float display_scale;
+    bool draw_landmarks;
+    bool hud_debug;
+    std::vector<std::string> sparklines;
+    float sparkline_seconds;
+};
+
+/** @brief Analyzes one camera or video file on its own thread, with its own capture thread,
+ * FrameDetector and listener, so several sources share one process instead of each paying for
+ * a separate one. Every result is handed to a callback tagged with the source id, and annotated
+ * frames go to an optional sink.
+ *
+ * The pipeline thread can be pinned to a CPU before it creates the capture thread and starts the
+ * detector; on Linux the threads it starts inherit the pinning, the detector's own threads included.
+ */
+class SourcePipeline
+{
+public:
+
+    /** @brief Called from the pipeline thread for every result
+    * @param source    -- Id of the source
+    * @param faces     -- Faces found in the frame
+    * @param timestamp -- Timestamp of the frame, in seconds since the shared start time
+    */
+    typedef std::function<void(const int source, const std::map<affdex::FaceId, affdex::Face>& faces,
+                               const double timestamp)> ResultCallback;
+
+    /** @brief SourcePipeline
+    * @param id       -- Id tagging the results of this source
+    * @param source   -- Camera id (digits only) or video file
+    * @param config   -- Detector and capture settings
+    * @param start    -- Time the timestamps are relative to, shared by all sources so they line up
+    * @param callback -- Receives the results
+    * @param sink     -- Receives the annotated frames, nullptr to skip drawing
+    * @param cpu      -- CPU to pin the pipeline to, -1 to leave it to the scheduler
+    */
+    SourcePipeline(const int id, const std::string& source, const PipelineConfig& config,
+                   const std::chrono::steady_clock::time_point& start, const ResultCallback& callback,
+                   FrameSink* sink = nullptr, const int cpu = -1);
+
+    ~SourcePipeline();
+
+    void start();
+
+    /** @brief Stop asks the pipeline to finish and waits for it
+    */
+    void stop();
+
+    bool isRunning() const { return mRunning; }
+
+    int getId() const { return mId; }
+
+    const std::string& getSource() const { return mSource; }
+
+    unsigned long getCapturedCount() const { return mCaptured; }
+
+    unsigned long getResultCount() const { return mResults; }
+
+    unsigned long getDroppedCount() const { return mDropped; }
+
+    /** @brief PinCurrentThread restricts the calling thread to one CPU
+    * @return false if pinning is not supported or failed
+    */
+    static bool pinCurrentThread(const int cpu);
+
+private:
+
+    void run();
+
+    const int mId;
+    const std::string mSource;
+    const PipelineConfig mConfig;
+    const std::chrono::steady_clock::time_point mStart;
+    const ResultCallback mCallback;
+    FrameSink* mSink;
+    const int mCpu;
+
+    std::atomic<bool> mStopRequested;
+    std::atomic<bool> mRunning;
+    std::thread mThread;
+
+    std::atomic<unsigned long> mCaptured;
+    std::atomic<unsigned long> mResults;
+    std::atomic<unsigned long> mDropped;
+};
@@ -28,6 +28,7 @@ public:
         std::cerr << "Encountered an exception while processing: " << ex.what() << std::endl;
         m.lock();
         mIsRunning = false;
+        mError = ex.what();
         m.unlock();
     };
     
@@ -49,8 +50,17 @@ public:
         return ret;
     };
     
+    /** @brief GetError returns the message of the exception that ended the processing, empty if it succeeded
+    */
+    std::string getError()
+    {
+        std::lock_guard<std::mutex> lg(m);
+        return mError;
+    };
+    
 private:
     std::mutex m;
     bool mIsRunning;
+    std::string mError;
     
 };
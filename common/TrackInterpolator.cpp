@@ -0,0 +1,96 @@
+#include "TrackInterpolator.h"
+#include <algorithm>
+#include <cstddef>
+
+TrackInterpolator::TrackInterpolator(const float max_extrapolation)
+    : mMaxExtrapolation(max_extrapolation), mResults(0), mLatestTimestamp(0)
+{
+}
+
+void TrackInterpolator::update(const std::map<affdex::FaceId, affdex::Face>& faces, const double timestamp)
+{
+    mResults++;
+    mLatestTimestamp = timestamp;
+
+    // Drop the tracks of faces that are gone
+    for (std::map<affdex::FaceId, Track>::iterator it = mTracks.begin(); it != mTracks.end();)
+    {
+        if (faces.find(it->first) == faces.end()) it = mTracks.erase(it);
+        else ++it;
+    }
+
+    for (auto & face_id_pair : faces)
+    {
+        std::map<affdex::FaceId, Track>::iterator it = mTracks.find(face_id_pair.first);
+        if (it == mTracks.end() || timestamp <= it->second.latest_ts)
+        {
+            // New face, or the stream restarted: nothing to interpolate from yet
+            Track& track = mTracks[face_id_pair.first];
+            track.latest = face_id_pair.second;
+            track.latest_ts = timestamp;
+            track.has_previous = false;
+            continue;
+        }
+        Track& track = it->second;
+        std::swap(track.previous, track.latest);
+        track.previous_ts = track.latest_ts;
+        track.latest = face_id_pair.second;
+        track.latest_ts = timestamp;
+        track.has_previous = true;
+    }
+}
+
+void TrackInterpolator::lerp(const float* from, const float* to, float* out, const size_t count, const float t)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = from[i] + (to[i] - from[i]) * t;
+    }
+}
+
+bool TrackInterpolator::interpolate(const double timestamp, std::map<affdex::FaceId, affdex::Face>& faces) const
+{
+    if (mResults == 0) return false;
+
+    // Faces that are gone are removed, the others are overwritten in place
+    for (std::map<affdex::FaceId, affdex::Face>::iterator it = faces.begin(); it != faces.end();)
+    {
+        if (mTracks.find(it->first) == mTracks.end()) it = faces.erase(it);
+        else ++it;
+    }
+
+    for (auto & id_track_pair : mTracks)
+    {
+        const Track& track = id_track_pair.second;
+        affdex::Face& face = faces[id_track_pair.first];
+        face = track.latest;
+        if (!track.has_previous) continue;
+
+        const double interval = track.latest_ts - track.previous_ts;
+        const float position = (float)((timestamp - track.previous_ts) / interval);
+        const float motion = (std::max)(0.0f, (std::min)(position, 1.0f + mMaxExtrapolation));
+        const float metric = (std::max)(0.0f, (std::min)(position, 1.0f));
+
+        const affdex::Face& from = track.previous;
+        const affdex::Face& to = track.latest;
+        lerp((const float *)&from.emotions, (const float *)&to.emotions, (float *)&face.emotions,
+             sizeof(affdex::Emotions) / sizeof(float), metric);
+        lerp((const float *)&from.expressions, (const float *)&to.expressions, (float *)&face.expressions,
+             sizeof(affdex::Expressions) / sizeof(float), metric);
+        // Everything before the dominant emoji is a probability
+        lerp((const float *)&from.emojis, (const float *)&to.emojis, (float *)&face.emojis,
+             offsetof(affdex::Emojis, dominantEmoji) / sizeof(float), metric);
+        lerp((const float *)&from.measurements, (const float *)&to.measurements, (float *)&face.measurements,
+             sizeof(affdex::Measurements) / sizeof(float), motion);
+
+        if (from.featurePoints.size() == to.featurePoints.size())
+        {
+            for (size_t i = 0; i < to.featurePoints.size(); i++)
+            {
+                face.featurePoints[i].x = from.featurePoints[i].x + (to.featurePoints[i].x - from.featurePoints[i].x) * motion;
+                face.featurePoints[i].y = from.featurePoints[i].y + (to.featurePoints[i].y - from.featurePoints[i].y) * motion;
+            }
+        }
+    }
+    return true;
+}
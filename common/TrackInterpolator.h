@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Face.h>
+#include <map>
+
+/** @brief Estimates the faces at any timestamp from the last two detector results of each face.
+ * The detector can then run at a fraction of the camera rate while every captured frame is still
+ * drawn and published with smoothly moving boxes, landmarks and metrics.
+ * Frames are meant to be drawn once a result at or after their timestamp is known (see
+ * getLatestTimestamp), i.e. one result interval late, so they fall between two results and are
+ * truly interpolated. Frames newer than the latest result are extrapolated along the last motion
+ * of the landmarks, at most by max_extrapolation result intervals; metric values are never
+ * extrapolated, so they stay within the range reported by the detector.
+ */
+class TrackInterpolator
+{
+public:
+
+    /** @brief TrackInterpolator
+    * @param max_extrapolation -- How far past the latest result landmarks keep moving, in result intervals
+    */
+    TrackInterpolator(const float max_extrapolation = 1.0f);
+
+    /** @brief Update records a detector result. Faces missing from it are forgotten.
+    * @param faces     -- Faces of the result
+    * @param timestamp -- Timestamp of the processed frame
+    */
+    void update(const std::map<affdex::FaceId, affdex::Face>& faces, const double timestamp);
+
+    /** @brief Interpolate estimates the faces at a timestamp
+    * @param timestamp -- Timestamp of the frame being drawn
+    * @param faces     -- Receives the estimated faces, its storage is reused
+    * @return false until a first result was recorded
+    */
+    bool interpolate(const double timestamp, std::map<affdex::FaceId, affdex::Face>& faces) const;
+
+    unsigned long getResultCount() const { return mResults; }
+
+    /** @brief GetLatestTimestamp returns the timestamp of the latest result, with or without faces.
+    * Frames up to it can be interpolated.
+    */
+    double getLatestTimestamp() const { return mLatestTimestamp; }
+
+private:
+
+    struct Track
+    {
+        affdex::Face previous;
+        affdex::Face latest;
+        double previous_ts;
+        double latest_ts;
+        bool has_previous;
+    };
+
+    static void lerp(const float* from, const float* to, float* out, const size_t count, const float t);
+
+    const float mMaxExtrapolation;
+    std::map<affdex::FaceId, Track> mTracks;
+    unsigned long mResults;
+    double mLatestTimestamp;
+};
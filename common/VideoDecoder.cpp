@@ -0,0 +1,124 @@
+#include "VideoDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    // Seconds a frame may fall short of the grid point it is on, half of the millisecond media times are rounded to
+    const double SLOT_TOLERANCE = 0.5e-3;
+}
+
+VideoDecoder::VideoDecoder(const std::string& path, const float sample_rate, const size_t queue_length,
+                           const double begin, const double end)
+    : mPath(path), mSampleRate(sample_rate), mBegin(begin), mEnd(end), mFramerate(0), mDuration(0),
+      mQueue(std::max<size_t>(1, queue_length)), mHead(0), mTail(0), mReleased(0), mFinished(false),
+      mStopRequested(false), mDecoded(0), mFullTime(0), mEmptyTime(0)
+{
+}
+
+VideoDecoder::~VideoDecoder()
+{
+    stop();
+}
+
+bool VideoDecoder::start()
+{
+    if (mThread.joinable()) return true;
+
+    // OpenCV 2.4's FFmpeg backend already decodes on one thread per CPU, and offers no setting for it.
+    // Later versions read their decoder options from OPENCV_FFMPEG_CAPTURE_OPTIONS, e.g. "threads;8".
+    if (!mCapture.open(mPath)) return false;
+
+    mFramerate = mCapture.get(CV_CAP_PROP_FPS);
+    const double frames = mCapture.get(CV_CAP_PROP_FRAME_COUNT);
+    mDuration = mFramerate > 0 && frames > 0 ? frames / mFramerate : 0;
+    if (mBegin > 0)
+    {
+        mCapture.set(CV_CAP_PROP_POS_MSEC, mBegin * 1000);
+    }
+
+    mThread = std::thread(&VideoDecoder::run, this);
+    return true;
+}
+
+void VideoDecoder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mStopRequested = true;
+    }
+    mSlotFree.notify_all();
+    mFrameReady.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+const DecodedFrame* VideoDecoder::acquire()
+{
+    const auto started = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFrameReady.wait(lock, [&] { return mStopRequested || mHead < mTail || mFinished; });
+    mEmptyTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (mStopRequested || mHead == mTail) return nullptr;
+
+    return &mQueue[mHead++ % mQueue.size()];
+}
+
+void VideoDecoder::release(const DecodedFrame* frame)
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mReleased++;
+    }
+    mSlotFree.notify_one();
+}
+
+long long VideoDecoder::sampleSlot(const double timestamp, const float sample_rate)
+{
+    return (long long)std::floor((timestamp + SLOT_TOLERANCE) * sample_rate);
+}
+
+void VideoDecoder::run()
+{
+    long long last_slot = -1;
+    while (mCapture.grab())
+    {
+        const double timestamp = mCapture.get(CV_CAP_PROP_POS_MSEC) / 1000.0;
+        if (timestamp >= mEnd) break;
+        if (timestamp < mBegin) continue;
+
+        // Sampling is decided before the frame is converted, skipped frames cost only their decoding
+        if (mSampleRate > 0)
+        {
+            const long long slot = sampleSlot(timestamp, mSampleRate);
+            if (slot <= last_slot) continue;
+            last_slot = slot;
+        }
+
+        DecodedFrame* frame;
+        {
+            const auto started = std::chrono::steady_clock::now();
+            std::unique_lock<std::mutex> lock(mMutex);
+            mSlotFree.wait(lock, [&] { return mStopRequested || mTail - mReleased < mQueue.size(); });
+            mFullTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            if (mStopRequested) break;
+            frame = &mQueue[mTail % mQueue.size()];
+        }
+
+        // The slot belongs to this thread until it is published, its buffer is reused when the size matches
+        if (!mCapture.retrieve(frame->image)) break;
+        frame->timestamp = timestamp;
+        frame->index = mDecoded++;
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            mTail++;
+        }
+        mFrameReady.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mFinished = true;
+    }
+    mFrameReady.notify_all();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+/** @brief One decoded frame, owned by the decoder until it is released
+ */
+struct DecodedFrame
+{
+    cv::Mat image;
+    double timestamp;       // Media time of the frame, in seconds
+    unsigned long index;    // Number of the frame among the decoded ones
+};
+
+/** @brief Decodes a video file on a dedicated thread into a bounded queue of reused frame buffers,
+ * so decoding overlaps with processing. Unlike the CaptureThread nothing is dropped: the decoder
+ * waits when the queue is full.
+ *
+ * Frames can be sampled at a fixed rate on a grid anchored at the start of the video; frames that
+ * are not sampled are grabbed but never converted. A time range restricts decoding to part of the
+ * video.
+ */
+class VideoDecoder
+{
+public:
+
+    /** @brief VideoDecoder
+    * @param path         -- Video file
+    * @param sample_rate  -- Frames per second of media time to keep, 0 keeps every frame
+    * @param queue_length -- Number of decoded frames held ahead of the consumer
+    * @param begin        -- Media time of the first frame to decode, in seconds
+    * @param end          -- Media time decoding stops at, in seconds
+    */
+    VideoDecoder(const std::string& path, const float sample_rate, const size_t queue_length,
+                 const double begin = 0, const double end = std::numeric_limits<double>::infinity());
+
+    ~VideoDecoder();
+
+    /** @brief Start opens the video, seeks to the beginning of the range and starts decoding
+    * @return false if the video cannot be opened
+    */
+    bool start();
+
+    void stop();
+
+    /** @brief Acquire blocks until the next frame is decoded
+    * @return the frame, to be handed back with release, or nullptr at the end of the range
+    */
+    const DecodedFrame* acquire();
+
+    /** @brief Release returns the oldest acquired frame's buffer to the queue. Frames are released
+    * in the order they were acquired: the decoder reuses buffers in that order, whichever frame is
+    * passed, so releasing a newer frame first would let the decoder overwrite the oldest one.
+    * @param frame -- The oldest frame acquired and not released yet
+    */
+    void release(const DecodedFrame* frame);
+
+    /** @brief GetFramerate returns the framerate reported by the container, valid after start
+    */
+    double getFramerate() const { return mFramerate; }
+
+    /** @brief GetDuration returns the duration reported by the container in seconds, 0 if unknown, valid after start
+    */
+    double getDuration() const { return mDuration; }
+
+    unsigned long getDecodedCount() const { return mDecoded; }
+
+    /** @brief GetFullTime returns the time the decoder waited for room in the queue, in seconds.
+    * A large value means processing is the bottleneck.
+    */
+    double getFullTime() const { return mFullTime; }
+
+    /** @brief GetEmptyTime returns the time acquire waited for the decoder, in seconds.
+    * A large value means decoding is the bottleneck.
+    */
+    double getEmptyTime() const { return mEmptyTime; }
+
+    /** @brief SampleSlot returns the slot of the sampling grid a frame falls in, the first frame of
+    * each slot is kept. Media times are computed from the frame number, or rounded to milliseconds by
+    * some backends, so a frame on a grid point often falls a little below it; up to half a millisecond
+    * short, it counts in the slot starting there.
+    * @param timestamp   -- Media time of the frame, in seconds
+    * @param sample_rate -- Frames per second of media time to keep
+    */
+    static long long sampleSlot(const double timestamp, const float sample_rate);
+
+private:
+
+    void run();
+
+    const std::string mPath;
+    const float mSampleRate;
+    const double mBegin;
+    const double mEnd;
+
+    cv::VideoCapture mCapture;
+    double mFramerate;
+    double mDuration;
+
+    std::vector<DecodedFrame> mQueue;
+    size_t mHead;           // Total number of frames acquired
+    size_t mTail;           // Total number of frames decoded into the queue
+    size_t mReleased;       // Total number of frames released
+    bool mFinished;
+    bool mStopRequested;
+
+    std::mutex mMutex;
+    std::condition_variable mFrameReady;
+    std::condition_variable mSlotFree;
+    std::thread mThread;
+
+    std::atomic<unsigned long> mDecoded;
+    double mFullTime;
+    double mEmptyTime;
+};
@@ -0,0 +1,165 @@
+#include "VideoRecorder.h"
+#include <iostream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+VideoRecorder::VideoRecorder(const std::string& path, const double fps, const size_t queue_length,
+                             const int fourcc)
+    : mPath(path), mFps(fps), mQueueLength(queue_length), mFourcc(fourcc),
+      mRunning(true), mFailed(false), mOrigin(0), mSlots(0), mWritten(0), mDropped(0), mRepeated(0), mEnqueued(0),
+      mEnqueueTicks(0), mEncodeTicks(0)
+{
+    // Spare buffers beyond the queue for the frame being encoded and the one held until the next is due
+    mPool.resize(mQueueLength + 2);
+    mThread = std::thread(&VideoRecorder::run, this);
+}
+
+VideoRecorder::~VideoRecorder()
+{
+    stop();
+}
+
+void VideoRecorder::onFrame(const cv::Mat& frame, const double timestamp)
+{
+    const int64 start = cv::getTickCount();
+    cv::Mat buffer;
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        if (!mRunning || mFailed || mPool.empty())
+        {
+            mDropped++;
+            return;
+        }
+        buffer = mPool.back();
+        mPool.pop_back();
+    }
+
+    frame.copyTo(buffer);
+
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mQueue.push_back(std::make_pair(buffer, timestamp));
+        mEnqueued++;
+        mEnqueueTicks += cv::getTickCount() - start;
+    }
+    mCondition.notify_one();
+}
+
+void VideoRecorder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_one();
+    if (mThread.joinable()) mThread.join();
+}
+
+void VideoRecorder::run()
+{
+    // A frame is held until the next one tells how long it was shown
+    cv::Mat held;
+    double held_time = 0;
+    while (true)
+    {
+        std::pair<cv::Mat, double> item;
+        {
+            std::unique_lock<std::mutex> lk(mMutex);
+            mCondition.wait(lk, [this] { return !mQueue.empty() || !mRunning; });
+            if (mQueue.empty()) break;
+            item = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        if (held.empty())
+        {
+            mOrigin = item.second;
+        }
+        else
+        {
+            const unsigned long written = write(held, item.second);
+            std::lock_guard<std::mutex> lg(mMutex);
+            if (written == 0) mDropped++;
+            mPool.push_back(held);
+        }
+        held = item.first;
+        held_time = item.second;
+    }
+
+    // The last frame is shown for one output frame
+    if (!held.empty() && write(held, held_time + 1.0 / mFps) == 0)
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        mDropped++;
+    }
+    mWriter.release();
+}
+
+unsigned long VideoRecorder::write(const cv::Mat& frame, const double end)
+{
+    unsigned long written = 0;
+    if (mFailed) return written;
+    const cv::Mat* image = &frame;
+    while (mOrigin + mSlots / mFps < end)
+    {
+        const int64 start = cv::getTickCount();
+        if (!mWriter.isOpened())
+        {
+            mSize = frame.size();
+            if (!mWriter.open(mPath, mFourcc, mFps, mSize, true))
+            {
+                // Reported once, every later frame is dropped without trying again
+                std::cerr << "Unable to open video file " << mPath << " for recording" << std::endl;
+                std::lock_guard<std::mutex> lg(mMutex);
+                mFailed = true;
+                break;
+            }
+        }
+        // The writer silently drops frames of another size
+        if (written == 0 && frame.size() != mSize)
+        {
+            cv::resize(frame, mResized, mSize, 0, 0, cv::INTER_AREA);
+            image = &mResized;
+        }
+        mWriter.write(*image);
+        mSlots++;
+        written++;
+        const int64 ticks = cv::getTickCount() - start;
+
+        std::lock_guard<std::mutex> lg(mMutex);
+        mWritten++;
+        mEncodeTicks += ticks;
+        if (written > 1) mRepeated++;
+    }
+    return written;
+}
+
+unsigned long VideoRecorder::getWrittenCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mWritten;
+}
+
+unsigned long VideoRecorder::getDroppedCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mDropped;
+}
+
+unsigned long VideoRecorder::getRepeatedCount()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mRepeated;
+}
+
+double VideoRecorder::getEnqueueTime()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mEnqueued ? 1000.0 * mEnqueueTicks / cv::getTickFrequency() / mEnqueued : 0.0;
+}
+
+double VideoRecorder::getEncodeTime()
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mWritten ? 1000.0 * mEncodeTicks / cv::getTickFrequency() / mWritten : 0.0;
+}
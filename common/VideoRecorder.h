@@ -0,0 +1,97 @@
+#pragma once
+
+#include <opencv2/highgui/highgui.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameSink.h"
+
+/** @brief Writes annotated frames to a video file from a background encoder thread.
+ * Frames are copied into recycled buffers and queued; when the queue is full the
+ * frame is dropped and counted so the caller never waits on the encoder.
+ *
+ * The file has a constant framerate while frames arrive at whatever rate results are drawn, so
+ * frames are placed by their timestamps: each one is repeated until the next one is due, and a
+ * frame arriving before the next output frame is due is dropped. Playback therefore keeps the
+ * original timing. Frames of another size than the first are resized to it.
+ */
+class VideoRecorder : public FrameSink
+{
+public:
+
+    /** @brief VideoRecorder
+    * @param path         -- Output video file, opened when the first frame arrives
+    * @param fps          -- Framerate of the output file, frames are repeated or dropped to fill it
+    * @param queue_length -- Maximum number of frames waiting to be encoded
+    * @param fourcc       -- Codec used by cv::VideoWriter
+    */
+    VideoRecorder(const std::string& path, const double fps, const size_t queue_length = 8,
+                  const int fourcc = CV_FOURCC('M', 'J', 'P', 'G'));
+
+    ~VideoRecorder();
+
+    void onFrame(const cv::Mat& frame, const double timestamp) override;
+
+    /** @brief Stop flushes the queued frames and closes the output file
+    */
+    void stop();
+
+    unsigned long getWrittenCount();
+
+    /** @brief GetDroppedCount returns the frames dropped because the queue was full, or because
+    * a newer frame was already due
+    */
+    unsigned long getDroppedCount();
+
+    /** @brief GetRepeatedCount returns the output frames that repeat the previous one
+    */
+    unsigned long getRepeatedCount();
+
+    /** @brief GetEnqueueTime average time the drawing thread spent handing over a frame
+    * @return time in milliseconds
+    */
+    double getEnqueueTime();
+
+    /** @brief GetEncodeTime average time the encoder thread spent writing a frame
+    * @return time in milliseconds
+    */
+    double getEncodeTime();
+
+private:
+
+    void run();
+
+    /** @brief Write writes frame for every output frame due before end, returns how many
+    */
+    unsigned long write(const cv::Mat& frame, const double end);
+
+    const std::string mPath;
+    const double mFps;
+    const size_t mQueueLength;
+    const int mFourcc;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::pair<cv::Mat, double> > mQueue;
+    std::vector<cv::Mat> mPool;
+    bool mRunning;
+    bool mFailed;               // The file could not be opened, frames are dropped
+
+    cv::VideoWriter mWriter;
+    cv::Size mSize;
+    cv::Mat mResized;
+    double mOrigin;             // Timestamp of the first output frame
+    unsigned long mSlots;       // Output frames written or due so far
+    std::thread mThread;
+
+    unsigned long mWritten;
+    unsigned long mDropped;
+    unsigned long mRepeated;
+    unsigned long mEnqueued;
+    double mEnqueueTicks;
+    double mEncodeTicks;
+};
@@ -1,15 +1,59 @@
 #include "Visualizer.h"
-#include <boost/format.hpp>
-#include "affdex_small_logo.h"
+#include "AffdexLogo.h"
 #include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
 #include <zmq.hpp>
 #include <msgpack.hpp>
 #include <vector>
 
 
 //String msge;
-std::vector<double> messageEmotions;
+// Sized once here, Visualizers are constructed concurrently by the pipelines of several sources
+std::vector<double> messageEmotions(9, 0.0);
+// Faces may be rendered concurrently, this guards the EmoSens outputs above
+static std::mutex emosens_mutex;
+
+/** @brief Updates the cached metric layers of a range of faces
+ */
+class Visualizer::HudRenderBody : public cv::ParallelLoopBody
+{
+public:
+    HudRenderBody(Visualizer& viz) : viz_(viz) {}
+
+    void operator()(const cv::Range& range) const override
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            viz_.renderFaceHud(*viz_.frame_huds[i], *viz_.frame_faces[i]);
+        }
+    }
+
+private:
+    Visualizer& viz_;
+};
+
+/** @brief Composites every face onto a horizontal band of rows of the image
+ */
+class Visualizer::HudCompositeBody : public cv::ParallelLoopBody
+{
+public:
+    HudCompositeBody(Visualizer& viz) : viz_(viz) {}
+
+    void operator()(const cv::Range& range) const override
+    {
+        cv::Mat band = viz_.img.rowRange(range.start, range.end);
+        const cv::Point offset(0, range.start);
+        for (const FaceHud* hud : viz_.frame_huds)
+        {
+            viz_.compositeFaceHud(*hud, band, offset);
+        }
+    }
+
+private:
+    Visualizer& viz_;
+};
 
 
 Visualizer::Visualizer():
@@ -20,7 +64,9 @@ Visualizer::Visualizer():
   }),
   RED_COLOR_CLASSIFIERS({
     "anger", "disgust", "sadness", "fear", "contempt"
-  })
+  }),
+  valence_color_generator( -100, 100 ),
+  white_yellow_generator( 0, 100, cv::Scalar(255,255,255), cv::Scalar(0, 255, 255) )
 {
     
    
@@ -28,10 +74,22 @@ Visualizer::Visualizer():
     
     
 
-    for (int i=0; i<9 ;i++) messageEmotions.push_back(0); 
-
-    logo_resized = false;
-    logo = cv::imdecode(cv::InputArray(small_logo), CV_LOAD_IMAGE_UNCHANGED);
+    display_scale = 1.0f;
+    display_interval = 0.0;
+    last_render_ts = -1.0;
+    show_window = true;
+    display_box.resize(4);
+    hud_debug = false;
+    frame_counter = 0;
+    left_panel_rows = 0;
+    sparkline_seconds = 10;
+    sparkline_label_width = 0;
+
+    // Opacity of a landmark dot, same radius as the circles drawn previously plus the anti-aliased fringe
+    const int landmark_radius = 2;
+    landmark_sprite = cv::Mat::zeros(2 * landmark_radius + 3, 2 * landmark_radius + 3, CV_8UC1);
+    cv::circle(landmark_sprite, cv::Point(landmark_radius + 1, landmark_radius + 1), landmark_radius,
+               cv::Scalar(255), 1, CV_AA);
 
     EXPRESSIONS = {
         "smile", "innerBrowRaise", "browRaise", "browFurrow", "noseWrinkle",
@@ -89,70 +147,488 @@ Visualizer::Visualizer():
     };
 }
 
-void Visualizer::drawFaceMetrics(affdex::Face face, std::vector<cv::Point2f> bounding_box)
+void Visualizer::setDisplayPolicy(const float max_fps, const float scale)
+{
+    display_interval = max_fps > 0 ? 1.0 / max_fps : 0.0;
+    display_scale = (scale > 0.0f && scale < 1.0f) ? scale : 1.0f;
+    last_render_ts = -1.0;
+}
+
+bool Visualizer::shouldRender(const double timestamp)
+{
+    // A timestamp going backwards means the source restarted (e.g. a looped video)
+    if (last_render_ts >= 0 && timestamp >= last_render_ts &&
+        timestamp - last_render_ts < display_interval)
+    {
+        return false;
+    }
+    last_render_ts = timestamp;
+    return true;
+}
+
+void Visualizer::drawFaceMetrics(const affdex::Face& face, const std::vector<cv::Point2f>& bounding_box)
+{
+    for (size_t corner = 0; corner < display_box.size(); corner++)
+    {
+        display_box[corner] = toDisplay(bounding_box[corner]);
+    }
+
+    FaceHud& hud = faceHud(face, display_box);
+    renderFaceHud(hud, face);
+    hud.right.composite(img, hud.right_anchor);
+    hud.left.composite(img, hud.left_anchor);
+    hud.sparklines.composite(img, hud.sparkline_anchor);
+
+    if (hud_debug)
+    {
+        hud.right.drawDirtyRects(img, hud.right_anchor, cv::Scalar(255, 0, 255));
+        hud.left.drawDirtyRects(img, hud.left_anchor, cv::Scalar(255, 0, 255));
+        hud.sparklines.drawDirtyRects(img, hud.sparkline_anchor, cv::Scalar(255, 0, 255));
+    }
+}
+
+void Visualizer::drawFaces(const std::map<affdex::FaceId, affdex::Face>& faces,
+                           const std::vector<std::vector<cv::Point2f> >& bounding_boxes)
+{
+    // Cache lookups modify hud_cache, so they are done before going parallel
+    frame_huds.clear();
+    frame_faces.clear();
+    size_t i = 0;
+    for (auto & face_id_pair : faces)
+    {
+        const affdex::Face& face = face_id_pair.second;
+        for (size_t corner = 0; corner < display_box.size(); corner++)
+        {
+            display_box[corner] = toDisplay(bounding_boxes[i][corner]);
+        }
+        i++;
+
+        FaceHud& hud = faceHud(face, display_box);
+        hud.box_color = valence_color_generator(face.emotions.valence);
+        frame_huds.push_back(&hud);
+        frame_faces.push_back(&face);
+    }
+    if (frame_huds.empty()) return;
+
+    if (frame_huds.size() == 1)
+    {
+        // Not worth the threading overhead, and keeps the single face path free of allocations
+        HudRenderBody(*this)(cv::Range(0, 1));
+        HudCompositeBody(*this)(cv::Range(0, img.rows));
+    }
+    else
+    {
+        cv::parallel_for_(cv::Range(0, (int)frame_huds.size()), HudRenderBody(*this));
+
+        // Bands of at least 32 rows keep the per band overhead low
+        const int min_band_rows = 32;
+        cv::parallel_for_(cv::Range(0, img.rows), HudCompositeBody(*this),
+                          (std::max)(1, img.rows / min_band_rows));
+    }
+
+    if (hud_debug)
+    {
+        for (FaceHud* hud : frame_huds)
+        {
+            hud->right.drawDirtyRects(img, hud->right_anchor, cv::Scalar(255, 0, 255));
+            hud->left.drawDirtyRects(img, hud->left_anchor, cv::Scalar(255, 0, 255));
+            hud->sparklines.drawDirtyRects(img, hud->sparkline_anchor, cv::Scalar(255, 0, 255));
+        }
+    }
+}
+
+Visualizer::FaceHud& Visualizer::faceHud(const affdex::Face& face, const std::vector<cv::Point2f>& bounding_box)
+{
+    FaceHud& hud = hud_cache[face.id];
+    hud.last_frame = frame_counter;
+    if (hud.right.empty())
+    {
+        // The layout only depends on the names, it is measured for the first face only
+        if (left_panel_rows == 0)
+        {
+            std::vector<std::string> left_names(HEAD_ANGLES);
+            left_names.insert(left_names.end(), { "gender", "age", "ethnicity" });
+            left_names.insert(left_names.end(), EMOTIONS.begin(), EMOTIONS.end());
+            left_panel_bounds = panelBounds(left_names, true);
+            left_panel_rows = left_names.size();
+            right_panel_bounds = panelBounds(EXPRESSIONS, false);
+        }
+        hud.left.reset(left_panel_bounds, left_panel_rows);
+        hud.right.reset(right_panel_bounds, EXPRESSIONS.size());
+    }
+    if (hud.sparklines.empty() && !sparkline_metrics.empty())
+    {
+        const size_t rows = sparkline_metrics.size();
+        hud.sparklines.reset(cv::Rect(0, 0, sparkline_label_width + sparkline_width, rows * sparkline_row_height), rows);
+        // Room for 30 results per second to start with, grown if they arrive faster
+        hud.history.reset(rows, (size_t)(sparkline_seconds * 30) + 1);
+        hud.samples.resize(rows);
+        hud.drawn_samples.resize(rows);
+        hud.sparkline_carry = 0;
+    }
+
+    hud.right_anchor = cv::Point(bounding_box[2].x + spacing, bounding_box[0].y); //Top right
+    hud.left_anchor = cv::Point(bounding_box[0].x - spacing, bounding_box[2].y);  //Top left
+    hud.top_left = bounding_box[0];
+    hud.bottom_right = bounding_box[1];
+    hud.sparkline_anchor = cv::Point(bounding_box[0].x, bounding_box[1].y + spacing / 2);   //Below the box
+    return hud;
+}
+
+void Visualizer::renderFaceHud(FaceHud& hud, const affdex::Face& face)
 {
     cv::Scalar white_color = cv::Scalar(255, 255, 255);
 
+    hud.left.beginFrame();
+    hud.right.beginFrame();
+
+    // Panels are drawn relative to their anchor, rows start one spacing below it
     //Draw Right side metrics
-    int padding = bounding_box[0].y; //Top left Y
-    drawValues((float *)&face.expressions, EXPRESSIONS,
-               bounding_box[2].x + spacing, padding, white_color, false);
+    int padding = 0;
+    drawValues(hud.right, (float *)&face.expressions, EXPRESSIONS,
+               0, padding, white_color, false);
 
-    padding = bounding_box[2].y;  //Top left Y
+    padding = 0;
     //Draw Head Angles
-    drawHeadOrientation(face.measurements.orientation,
-                        bounding_box[0].x - spacing, padding);
+    drawHeadOrientation(hud.left, face.measurements.orientation, 0, padding);
 
     //Draw Appearance
-    drawAppearance(face.appearance, bounding_box[0].x - spacing, padding);
+    drawAppearance(hud.left, face.appearance, 0, padding);
 
     //Draw Left side metrics
-    drawValues((float *)&face.emotions, EMOTIONS,
-               bounding_box[0].x - spacing, padding, white_color, true);
+    drawValues(hud.left, (float *)&face.emotions, EMOTIONS,
+               0, padding, white_color, true);
+
+    if (!hud.sparklines.empty())
+    {
+        hud.sparklines.beginFrame();
+        renderSparklines(hud, face);
+    }
+}
+
+void Visualizer::setSparklines(const std::vector<std::string>& metrics, const float seconds)
+{
+    // Distinct colors for the lines of a face, cycled through
+    const cv::Scalar palette[] = {
+        cv::Scalar(0, 255, 255), cv::Scalar(255, 255, 0), cv::Scalar(255, 0, 255),
+        cv::Scalar(0, 165, 255), cv::Scalar(0, 255, 0), cv::Scalar(255, 128, 128)
+    };
+    const size_t palette_size = sizeof(palette) / sizeof(palette[0]);
+
+    sparkline_names.clear();
+    sparkline_metrics.clear();
+    sparkline_label_width = 0;
+    for (const std::string& name : metrics)
+    {
+        SparklineMetric metric;
+        std::vector<std::string>::const_iterator it = std::find(EMOTIONS.begin(), EMOTIONS.end(), name);
+        metric.emotion = it != EMOTIONS.end();
+        if (metric.emotion)
+        {
+            metric.index = it - EMOTIONS.begin();
+        }
+        else
+        {
+            it = std::find(EXPRESSIONS.begin(), EXPRESSIONS.end(), name);
+            if (it == EXPRESSIONS.end())
+            {
+                std::cerr << "Unknown metric " << name << ", no sparkline drawn for it" << std::endl;
+                continue;
+            }
+            metric.index = it - EXPRESSIONS.begin();
+        }
+        metric.low = name == "valence" ? -100.0f : 0.0f;
+        metric.color = palette[sparkline_metrics.size() % palette_size];
+        sparkline_metrics.push_back(metric);
+        sparkline_names.push_back(name);
+
+        int baseline = 0;
+        const int width = cv::getTextSize(name, cv::FONT_HERSHEY_SIMPLEX, 0.5f, 1, &baseline).width;
+        sparkline_label_width = (std::max)(sparkline_label_width, width + 6);
+    }
+    sparkline_seconds = seconds > 0 ? seconds : 10;
 
+    // The cached layers were laid out for the previous selection
+    for (auto& face_hud : hud_cache)
+    {
+        face_hud.second.sparklines = HudPanel();
+    }
 }
 
-void Visualizer::drawValues(const float * first, const std::vector<std::string> names,
+int Visualizer::sparklineY(const SparklineMetric& metric, const size_t row, const float value) const
+{
+    const int top = row * sparkline_row_height + 2;
+    const int height = sparkline_row_height - 4;
+    float level = (value - metric.low) / (100.0f - metric.low);
+    if (!(level > 0.0f)) level = 0.0f;
+    if (level > 1.0f) level = 1.0f;
+    return top + (int)((height - 1) * (1.0f - level) + 0.5f);
+}
+
+void Visualizer::renderSparklines(FaceHud& hud, const affdex::Face& face)
+{
+    for (size_t i = 0; i < sparkline_metrics.size(); i++)
+    {
+        const SparklineMetric& metric = sparkline_metrics[i];
+        const float* values = metric.emotion ? (const float *)&face.emotions : (const float *)&face.expressions;
+        hud.samples[i] = values[metric.index];
+    }
+
+    const double timestamp = last_render_ts;
+    const double previous_timestamp = hud.history.empty() ? timestamp : hud.history.timestamp(hud.history.size() - 1);
+    // A stream that restarted has nothing in common with the recorded samples
+    if (timestamp < previous_timestamp) hud.history.clear();
+    // After a long gap the plot is rebuilt from the history rather than scrolled
+    const bool scrollable = !hud.history.empty() && timestamp - previous_timestamp < sparkline_seconds;
+    // A full history that does not cover the plot would drop samples still on screen
+    if (hud.history.size() == hud.history.capacity() && timestamp - hud.history.timestamp(0) < sparkline_seconds)
+    {
+        hud.history.grow(hud.history.capacity() * 2);
+    }
+    hud.history.push(timestamp, hud.samples.data());
+
+    for (size_t row = 0; row < sparkline_metrics.size(); row++)
+    {
+        if (hud.sparklines.needsLabel(row))
+        {
+            hud.sparklines.text(sparkline_names[row], cv::Point(0, (row + 1) * sparkline_row_height - 8),
+                                sparkline_metrics[row].color, 1);
+        }
+    }
+
+    if (!scrollable)
+    {
+        redrawSparklines(hud);
+        return;
+    }
+
+    // Shift by the elapsed time, keeping the fraction of a pixel for the next frame
+    const double shift = (timestamp - previous_timestamp) * sparkline_width / sparkline_seconds + hud.sparkline_carry;
+    const int pixels = (int)shift;
+    if (pixels <= 0)
+    {
+        hud.sparkline_carry = shift;
+        return;
+    }
+    hud.sparkline_carry = shift - pixels;
+
+    const cv::Rect plot(sparkline_label_width, 0, sparkline_width, sparkline_metrics.size() * sparkline_row_height);
+    hud.sparklines.scroll(plot, pixels);
+
+    // Only the segment from the last sample drawn to the new one is drawn, samples that arrived
+    // within the same pixel in between are skipped
+    const int right = plot.x + plot.width - 1;
+    for (size_t row = 0; row < sparkline_metrics.size(); row++)
+    {
+        const SparklineMetric& metric = sparkline_metrics[row];
+        hud.sparklines.line(cv::Point(right - pixels, sparklineY(metric, row, hud.drawn_samples[row])),
+                            cv::Point(right, sparklineY(metric, row, hud.samples[row])),
+                            metric.color);
+    }
+    hud.drawn_samples = hud.samples;
+}
+
+void Visualizer::redrawSparklines(FaceHud& hud)
+{
+    const cv::Rect plot(sparkline_label_width, 0, sparkline_width, sparkline_metrics.size() * sparkline_row_height);
+    hud.sparklines.clear(plot);
+    hud.sparkline_carry = 0;
+    if (hud.history.empty()) return;
+    for (size_t row = 0; row < sparkline_metrics.size(); row++)
+    {
+        hud.drawn_samples[row] = hud.history.value(row, hud.history.size() - 1);
+    }
+
+    const int right = plot.x + plot.width - 1;
+    const double newest = hud.history.timestamp(hud.history.size() - 1);
+    const double pixels_per_second = sparkline_width / sparkline_seconds;
+    for (size_t i = 1; i < hud.history.size(); i++)
+    {
+        if (newest - hud.history.timestamp(i - 1) > sparkline_seconds) continue;
+        const int x0 = right - (int)((newest - hud.history.timestamp(i - 1)) * pixels_per_second + 0.5);
+        const int x1 = right - (int)((newest - hud.history.timestamp(i)) * pixels_per_second + 0.5);
+        for (size_t row = 0; row < sparkline_metrics.size(); row++)
+        {
+            const SparklineMetric& metric = sparkline_metrics[row];
+            hud.sparklines.line(cv::Point(x0, sparklineY(metric, row, hud.history.value(row, i - 1))),
+                                cv::Point(x1, sparklineY(metric, row, hud.history.value(row, i))),
+                                metric.color);
+        }
+    }
+}
+
+void Visualizer::compositeFaceHud(const FaceHud& hud, cv::Mat& target, const cv::Point& offset) const
+{
+    cv::rectangle(target, hud.top_left - offset, hud.bottom_right - offset, hud.box_color, 3);
+    hud.right.composite(target, hud.right_anchor - offset);
+    hud.left.composite(target, hud.left_anchor - offset);
+    hud.sparklines.composite(target, hud.sparkline_anchor - offset);
+}
+
+cv::Rect Visualizer::panelBounds(const std::vector<std::string>& names, const bool align_right) const
+{
+    const int equalizer_width = 100;
+    const int text_margin = 4;
+    // Room for values printed after a right justified label
+    const int value_overhang = 48;
+    // Extent of a row around its baseline, including the outline of the labels
+    const int row_above = 14;
+    const int row_below = 6;
+
+    int label_width = 0;
+    std::string label;
+    for (const std::string& name : names)
+    {
+        int baseline = 0;
+        if (align_right) label.assign(name).append(": ");
+        else label.assign(" :").append(name);
+        label_width = (std::max)(label_width, cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5f, 5, &baseline).width);
+    }
+
+    const int top = spacing - row_above;
+    const int height = spacing * (int)names.size() + row_below - top;
+    if (align_right)
+    {
+        const int left = -(equalizer_width + label_width + text_margin);
+        return cv::Rect(left, top, value_overhang - left, height);
+    }
+    return cv::Rect(-text_margin, top, equalizer_width + label_width + 2 * text_margin, height);
+}
+
+void Visualizer::drawValues(HudPanel& panel, const float * first, const std::vector<std::string>& names,
                             const int x, int &padding, const cv::Scalar clr, const bool align_right)
 {
 
-    for (std::string name : names)
+    for (const std::string& name : names)
     {
-        drawClassifierOutput(name, (*first), cv::Point(x, padding += spacing), align_right);
+        drawClassifierOutput(panel, name, (*first), cv::Point(x, padding += spacing), align_right);
         first++;
 // My additions to the code for EmoSens to work
-        if (name == "joy") std::cout  << name << ":" << (*first) << std::endl;
+        if (name == "joy")
+        {
+            std::lock_guard<std::mutex> lg(emosens_mutex);
+            std::cout  << name << ":" << (*first) << std::endl;
+        }
     }
 }
 
 void Visualizer::updateImage(cv::Mat output_img)
 {
-  img = output_img;
+  // Forget the HUD of faces that have not been drawn for a while
+  const unsigned long hud_cache_frames = 30;
+  frame_counter++;
+  for (auto it = hud_cache.begin(); it != hud_cache.end(); )
+  {
+      if (frame_counter - it->second.last_frame > hud_cache_frames) it = hud_cache.erase(it);
+      else ++it;
+  }
+
+  if (display_scale < 1.0f)
+  {
+      // Downscale once so the HUD is drawn on the preview sized image only
+      cv::resize(output_img, scaled_img, cv::Size(), display_scale, display_scale, cv::INTER_AREA);
+      img = scaled_img;
+  }
+  else
+  {
+      img = output_img;
+  }
+
+  drawLogo();
+}
+
+const Visualizer::LogoImage& Visualizer::logoFor(const int width)
+{
+  std::map<int, LogoImage>::iterator it = logo_cache.find(width);
+  if (it != logo_cache.end()) return it->second;
+
+  if (logo.color.empty()) embeddedLogo(logo.color, logo.alpha);
+
+  double logo_width = (logo.color.cols > width*0.25 ? width*0.25 : logo.color.cols);
+  double logo_height = ((double)logo_width) * ((double)logo.color.rows / logo.color.cols);
+  LogoImage& resized = logo_cache[width];
+  // Interpolating premultiplied pixels keeps the edges free of dark fringes
+  cv::resize(logo.color, resized.color, cv::Size(logo_width, logo_height), 0, 0, cv::INTER_AREA);
+  cv::resize(logo.alpha, resized.alpha, cv::Size(logo_width, logo_height), 0, 0, cv::INTER_AREA);
+  return resized;
+}
 
-  if (!logo_resized)
+void Visualizer::drawLogo()
+{
+  const LogoImage& resized = logoFor(img.cols);
+  const int right_margin = 10;
+  const int top_margin = 10;
+  const cv::Rect placed = cv::Rect(img.cols - resized.color.cols - right_margin, top_margin,
+                                   resized.color.cols, resized.color.rows);
+  const cv::Rect target = placed & cv::Rect(0, 0, img.cols, img.rows);
+  if (target.area() <= 0) return;
+
+  const int offset_x = target.x - placed.x;
+  const int offset_y = target.y - placed.y;
+  for (int y = 0; y < target.height; ++y)
   {
-      double logo_width = (logo.size().width > img.size().width*0.25 ? img.size().width*0.25 : logo.size().width);
-      double logo_height = ((double)logo_width) * ((double)logo.size().height / logo.size().width);
-      cv::resize(logo, logo, cv::Size(logo_width, logo_height));
-      logo_resized = true;
+      const uchar* alpha = resized.alpha.ptr<uchar>(y + offset_y) + offset_x;
+      const uchar* color = resized.color.ptr<uchar>(y + offset_y) + 3 * offset_x;
+      uchar* dst = img.ptr<uchar>(y + target.y) + 3 * target.x;
+      for (int x = 0; x < target.width; ++x, dst += 3, color += 3)
+      {
+          const int a = alpha[x];
+          if (a == 0) continue;
+          const int inv = 255 - a;
+          dst[0] = (uchar)((dst[0] * inv + 127) / 255 + color[0]);
+          dst[1] = (uchar)((dst[1] * inv + 127) / 255 + color[1]);
+          dst[2] = (uchar)((dst[2] * inv + 127) / 255 + color[2]);
+      }
   }
-  cv::Mat roi = img(cv::Rect(img.cols - logo.cols - 10, 10, logo.cols, logo.rows));
-  overlayImage(logo, roi, cv::Point(0, 0));
 }
 
-void Visualizer::drawPoints(affdex::VecFeaturePoint points)
+void Visualizer::drawPoints(const affdex::VecFeaturePoint& points)
 {
     for (auto& point : points)    //Draw face feature points.
     {
-        cv::circle(img, cv::Point(point.x, point.y), 2.0f, cv::Scalar(255, 255, 255));
+        stampLandmark(toDisplay(cv::Point2f(point.x, point.y)));
+    }
+}
+
+void Visualizer::drawPoints(const std::map<affdex::FaceId, affdex::Face>& faces)
+{
+    for (auto & face_id_pair : faces)
+    {
+        for (const affdex::FeaturePoint& point : face_id_pair.second.featurePoints)
+        {
+            stampLandmark(toDisplay(cv::Point2f(point.x, point.y)));
+        }
+    }
+}
+
+void Visualizer::stampLandmark(const cv::Point& center)
+{
+    const int radius = landmark_sprite.rows / 2;
+    const cv::Point origin(center.x - radius, center.y - radius);
+    const cv::Rect area = cv::Rect(origin.x, origin.y, landmark_sprite.cols, landmark_sprite.rows)
+                          & cv::Rect(0, 0, img.cols, img.rows);
+    if (area.area() <= 0) return;
+
+    for (int y = 0; y < area.height; ++y)
+    {
+        const uchar* alpha = landmark_sprite.ptr<uchar>(area.y - origin.y + y) + (area.x - origin.x);
+        uchar* dst = img.ptr<uchar>(area.y + y) + 3 * area.x;
+        for (int x = 0; x < area.width; ++x, dst += 3)
+        {
+            const int a = alpha[x];
+            if (a == 0) continue;
+            // Blend towards white
+            dst[0] += ((255 - dst[0]) * a + 127) / 255;
+            dst[1] += ((255 - dst[1]) * a + 127) / 255;
+            dst[2] += ((255 - dst[2]) * a + 127) / 255;
+        }
     }
 }
 
 void Visualizer::drawBoundingBox(cv::Point2f top_left, cv::Point2f bottom_right, float valence)
 {
     //Draw bounding box
-    const ColorgenRedGreen valence_color_generator( -100, 100 );
-    cv::rectangle( img, top_left, bottom_right,
+    cv::rectangle( img, toDisplay(top_left), toDisplay(bottom_right),
                    valence_color_generator(valence), 3);
 
 }
@@ -165,7 +641,7 @@ void Visualizer::drawBoundingBox(cv::Point2f top_left, cv::Point2f bottom_right,
  * @param align_right -- Whether to right or left justify the text
  * @param color         -- Color
  */
-void Visualizer::drawText(const std::string& name, const std::string& value,
+void Visualizer::drawText(HudPanel& panel, const char* name, const char* value,
                           const cv::Point2f loc, bool align_right, cv::Scalar color)
 {
     const int block_width = 8;
@@ -173,8 +649,14 @@ void Visualizer::drawText(const std::string& name, const std::string& value,
     const int block_size = 10;
     const int max_blocks = 100/block_size;
 
+    const int row = loc.y / spacing - 1;
+    if (!panel.changed(row, value, color)) return;
+    const cv::Rect& bounds = panel.getBounds();
+    panel.clear(cv::Rect(bounds.x, loc.y - spacing + 6, bounds.width, spacing));
+
     cv::Point2f display_loc = loc;
-    const std::string label = name+": ";
+    std::string& label = panel.scratch();
+    label.assign(name).append(": ");
 
     if( align_right )
     {
@@ -183,7 +665,8 @@ void Visualizer::drawText(const std::string& name, const std::string& value,
         cv::Size txtSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5f, 5,&baseline);
         display_loc.x -= txtSize.width;
     }
-    cv::putText(img, label+value, display_loc, cv::FONT_HERSHEY_SIMPLEX, 0.5f, color, 1);
+    label.append(value);
+    panel.text(label, display_loc, color, 1);
 }
 
 
@@ -194,13 +677,10 @@ void Visualizer::drawText(const std::string& name, const std::string& value,
  * @param loc         -- Exact location. When aligh_right is (true/false) this should be the (upper-right, upper-left)
  * @param align_right -- Whether to right or left justify the text
  */
-void Visualizer::drawClassifierOutput(const std::string& classifier,
+void Visualizer::drawClassifierOutput(HudPanel& panel, const std::string& classifier,
                                       const float value, const cv::Point2f& loc, bool align_right)
 {
 
-    static const ColorgenLinear white_yellow_generator( 0, 100, cv::Scalar(255,255,255), cv::Scalar(0, 255, 255));
-    static const ColorgenRedGreen valence_color_generator( -100, 100 );
-
     // Determine the display color
     cv::Scalar color = cv::Scalar(255, 255, 255);
     if( classifier == "valence")
@@ -222,13 +702,14 @@ void Visualizer::drawClassifierOutput(const std::string& classifier,
     {
         equalizer_magnitude = std::fabs(value);
     }
-    drawEqualizer(classifier, equalizer_magnitude, loc, align_right, color );
+    drawEqualizer(panel, classifier, equalizer_magnitude, loc, align_right, color );
 
     //std::cout  << classifier << ":" << value << std::endl;
 
 
 //ZeroMQ additions to allow Emosens to pull data
 
+	std::lock_guard<std::mutex> lg(emosens_mutex);
 	if( classifier == "joy")
 	messageEmotions.at(0) = value;
  	if( classifier == "fear") 
@@ -264,7 +745,7 @@ void Visualizer::drawClassifierOutput(const std::string& classifier,
 	//std::cout << message.data();
 }
 
-void Visualizer::drawEqualizer(const std::string& name, const float value, const cv::Point2f& loc,
+void Visualizer::drawEqualizer(HudPanel& panel, const std::string& name, const float value, const cv::Point2f& loc,
                                bool align_right, cv::Scalar color)
 {
     const int block_width = 8;
@@ -274,66 +755,100 @@ void Visualizer::drawEqualizer(const std::string& name, const float value, const
     const int max_blocks = 100/block_size;
     int blocks = round(value / block_size);
     int i = loc.x, j = loc.y - 10;
+    const int row = loc.y / spacing - 1;
 
-    cv::Point2f display_loc = loc;
-    const std::string label = align_right? name+": " : " :"+name;
+    // The label never changes, it is drawn the first time the row is seen
+    if (panel.needsLabel(row))
+    {
+        cv::Point2f display_loc = loc;
+        std::string& label = panel.scratch();
+        if (align_right) label.assign(name).append(": ");
+        else label.assign(" :").append(name);
+        display_loc.x += align_right? -(margin+block_width) * max_blocks : (margin+block_width) * max_blocks;
+        if( align_right )
+        {
+            int baseline=0;
+            cv::Size txtSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5f, 5,&baseline);
+            display_loc.x -= txtSize.width;
+        }
+        panel.text(label, display_loc, cv::Scalar(50,50,50), 5);
+        panel.text(label, display_loc, cv::Scalar(255, 255, 255), 1);
+    }
+
+    if (!panel.changed(row, blocks, color)) return;
+
+    const int first_block = align_right ? i - (margin+block_width) * (max_blocks-1) : i;
+    panel.clear(cv::Rect(first_block, j, (margin+block_width) * max_blocks - margin, block_height));
 
     for (int x = 0 ; x < (100/block_size) ; x++)
     {
-        cv::Scalar scalar_clr = color;
-        float  alpha = 0.8;
-        const int ii = (std::max)( float(i), 0.0f);
-        const int jj = (std::max)( float(j), 0.0f);
-        const int width = (std::min)(float(block_width), float(img.size().width-ii));
-        const int height = (std::min)(float(block_height), float(img.size().height-jj));
-        if (height < 0 || width < 0) continue;
-        cv::Mat roi = img(cv::Rect(ii, jj, width, height));
         if (x >= blocks)
         {
-            alpha = 0.3;
-            scalar_clr = cv::Scalar(186, 186, 186);
+            panel.fill(cv::Rect(i, j, block_width, block_height), cv::Scalar(186, 186, 186), 0.3f);
+        }
+        else
+        {
+            panel.fill(cv::Rect(i, j, block_width, block_height), color, 0.8f);
         }
-        cv::Mat color(roi.size(), CV_8UC3, scalar_clr);
-        cv::addWeighted(color, alpha, roi, 1.0 - alpha , 0.0, roi);
 
         i += align_right? -(margin+block_width):(margin+block_width);
     }
-    display_loc.x += align_right? -(margin+block_width) * max_blocks : (margin+block_width) * max_blocks;
-    if( align_right )
-    {
-        int baseline=0;
-        cv::Size txtSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5f, 5,&baseline);
-        display_loc.x -= txtSize.width;
-    }
-    cv::putText(img, label, display_loc, cv::FONT_HERSHEY_SIMPLEX, 0.5f, cv::Scalar(50,50,50), 5);
-    cv::putText(img, label, display_loc, cv::FONT_HERSHEY_SIMPLEX, 0.5f, cv::Scalar(255, 255, 255), 1);
-
 }
 
-void Visualizer::drawHeadOrientation(affdex::Orientation headAngles, const int x, int &padding,
+void Visualizer::drawHeadOrientation(HudPanel& panel, affdex::Orientation headAngles, const int x, int &padding,
                                      bool align_right, cv::Scalar color)
 {
-    std::string valueStr = boost::str(boost::format("%3.1f") % headAngles.pitch);
-    drawText("pitch", valueStr, cv::Point(x, padding += spacing), align_right, color );
-    valueStr = boost::str(boost::format("%3.1f") % headAngles.yaw);
-    drawText("yaw", valueStr, cv::Point(x, padding += spacing), align_right, color );
-    valueStr = boost::str(boost::format("%3.1f") % headAngles.roll);
-    drawText("roll", valueStr, cv::Point(x, padding += spacing), align_right, color );
+    char valueStr[32];
+    std::snprintf(valueStr, sizeof(valueStr), "%3.1f", headAngles.pitch);
+    drawText(panel, "pitch", valueStr, cv::Point(x, padding += spacing), align_right, color );
+    std::snprintf(valueStr, sizeof(valueStr), "%3.1f", headAngles.yaw);
+    drawText(panel, "yaw", valueStr, cv::Point(x, padding += spacing), align_right, color );
+    std::snprintf(valueStr, sizeof(valueStr), "%3.1f", headAngles.roll);
+    drawText(panel, "roll", valueStr, cv::Point(x, padding += spacing), align_right, color );
 }
 
-void Visualizer::drawAppearance(affdex::Appearance appearance, const int x, int &padding,
+void Visualizer::drawAppearance(HudPanel& panel, affdex::Appearance appearance, const int x, int &padding,
                               bool align_right, cv::Scalar color)
 {
-    drawText("gender", GENDER_MAP[appearance.gender], cv::Point(x, padding += spacing), align_right, color );
-    drawText("age", AGE_MAP[appearance.age], cv::Point(x, padding += spacing), align_right, color );
-    drawText("ethnicity", ETHNICITY_MAP[appearance.ethnicity], cv::Point(x, padding += spacing), align_right, color );
+    drawText(panel, "gender", GENDER_MAP.at(appearance.gender).c_str(), cv::Point(x, padding += spacing), align_right, color );
+    drawText(panel, "age", AGE_MAP.at(appearance.age).c_str(), cv::Point(x, padding += spacing), align_right, color );
+    drawText(panel, "ethnicity", ETHNICITY_MAP.at(appearance.ethnicity).c_str(), cv::Point(x, padding += spacing), align_right, color );
 
 }
 
 void Visualizer::showImage()
 {
-    cv::imshow("analyze video", img);
-    cv::waitKey(5);
+    // last_render_ts holds the timestamp of the frame accepted by shouldRender
+    for (FrameSink* sink : frame_sinks)
+    {
+        sink->onFrame(img, last_render_ts);
+    }
+
+    if (show_window)
+    {
+        cv::imshow("analyze video", img);
+        cv::waitKey(5);
+    }
+}
+
+void Visualizer::setHudDebug(const bool debug)
+{
+    hud_debug = debug;
+}
+
+void Visualizer::setShowWindow(const bool show)
+{
+    show_window = show;
+}
+
+void Visualizer::addFrameSink(FrameSink* sink)
+{
+    frame_sinks.push_back(sink);
+}
+
+bool Visualizer::hasFrameSinks() const
+{
+    return !frame_sinks.empty();
 }
 
 void Visualizer::overlayImage(const cv::Mat &foreground, cv::Mat &background, cv::Point2i location)
@@ -382,7 +897,19 @@ void Visualizer::overlayImage(const cv::Mat &foreground, cv::Mat &background, cv
     }
 }
 
-cv::Scalar ColorgenRedGreen::operator()( const float val ) const
+ColorgenRedGreen::ColorgenRedGreen( const float red_val, const float green_val )
+    :
+      red_val_(red_val),
+      green_val_(green_val),
+      lut_scale_( ( COLOR_LUT_SIZE - 1 ) / ( green_val - red_val ) )
+{
+    for( int i = 0; i < COLOR_LUT_SIZE; i++ )
+    {
+        lut_[i] = generate( red_val_ + i / lut_scale_ );
+    }
+}
+
+cv::Scalar ColorgenRedGreen::generate( const float val ) const
 {
     float norm_val = ( val - red_val_ ) / ( green_val_ - red_val_ );
     norm_val = norm_val < 0.0 ? 0.0 : norm_val;
@@ -394,7 +921,21 @@ cv::Scalar ColorgenRedGreen::operator()( const float val ) const
 }
 
 
-cv::Scalar ColorgenLinear::operator()( const float val ) const
+ColorgenLinear::ColorgenLinear( const float val1, const float val2, cv::Scalar color1, cv::Scalar color2 )
+    :
+      val1_(val1),
+      val2_(val2),
+      color1_(color1),
+      color2_(color2),
+      lut_scale_( ( COLOR_LUT_SIZE - 1 ) / ( val2 - val1 ) )
+{
+    for( int i = 0; i < COLOR_LUT_SIZE; i++ )
+    {
+        lut_[i] = generate( val1_ + i / lut_scale_ );
+    }
+}
+
+cv::Scalar ColorgenLinear::generate( const float val ) const
 {
     float norm_val = ( val - val1_ ) / ( val2_ - val1_ );
     const int B = color1_.val[0] * (1.0f-norm_val) + color2_.val[0]*norm_val;
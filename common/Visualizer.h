@@ -5,6 +5,88 @@
 #include <set>
 #include <zmq.hpp>
 
+#include "FrameSink.h"
+#include "HudPanel.h"
+#include "MetricHistory.h"
+
+/** @brief Number of entries in the color generator lookup tables, one per unit over [-100, 100]
+ */
+const int COLOR_LUT_SIZE = 201;
+
+/** @brief ColorLutIndex maps a value to the nearest entry of a color lookup table
+ * @param val   -- The value to look up
+ * @param first -- The value of the first entry
+ * @param scale -- Number of entries per unit of value
+ * @return Index clamped to [0, COLOR_LUT_SIZE-1]
+ */
+inline int colorLutIndex( const float val, const float first, const float scale )
+{
+    const float pos = ( val - first ) * scale;
+    // Written so that NaN maps to the first entry
+    if( !( pos > 0.0f ) ) return 0;
+    if( pos >= COLOR_LUT_SIZE - 1 ) return COLOR_LUT_SIZE - 1;
+    return (int)( pos + 0.5f );
+}
+
+/** @brief Color generator (linear) for red-to-green values
+ */
+class ColorgenRedGreen
+{
+public:
+    /** @brief ColorgenRedGreen
+     * @param[in] red_val - Value which will return green
+     * @param green_val - Value which will return green
+     */
+    ColorgenRedGreen( const float red_val, const float green_val );
+
+    /** @brief Generate accessor, looks the color up in a table precomputed over [red_val, green_val]
+     * @param val -- Value for which we would like to generate a color, clamped to the range
+     * @return  BGR Scalar for use in open cv plotting functions (e.g. cv::circle)
+     */
+    const cv::Scalar& operator()( const float val ) const
+    {
+        return lut_[colorLutIndex(val, red_val_, lut_scale_)];
+    }
+
+private:
+    cv::Scalar generate( const float val ) const;
+
+    const float red_val_;
+    const float green_val_;
+    const float lut_scale_;
+    cv::Scalar lut_[COLOR_LUT_SIZE];
+};
+
+/**
+ * @brief Color generator (linear) between any two colors
+ */
+class ColorgenLinear
+{
+public:
+    ColorgenLinear( const float val1, const float val2, cv::Scalar color1, cv::Scalar color2 );
+
+    /** @brief Generate accessor, looks the color up in a table precomputed over [val1, val2]
+     * @param val -- Value for which we would like to generate a color, clamped to the range
+     * @return  BGR Scalar for use in open cv plotting functions (e.g. cv::circle)
+     */
+    const cv::Scalar& operator()( const float val ) const
+    {
+        return lut_[colorLutIndex(val, val1_, lut_scale_)];
+    }
+
+private:
+  cv::Scalar generate( const float val ) const;
+
+  const float val1_;
+  const float val2_;
+
+  const cv::Scalar color1_;
+  const cv::Scalar color2_;
+
+  const float lut_scale_;
+  cv::Scalar lut_[COLOR_LUT_SIZE];
+};
+
 /** @brief Plot the face metrics using opencv highgui
  */
 class Visualizer
@@ -18,10 +100,29 @@ public:
   */
   void updateImage(cv::Mat output_img);
 
+  /** @brief SetDisplayPolicy bounds how often and at what size frames get rendered
+  * @param max_fps -- Maximum number of frames drawn per second (0 draws every frame)
+  * @param scale   -- Preview scale factor applied to the frame before drawing, in (0, 1]
+  */
+  void setDisplayPolicy(const float max_fps, const float scale);
+
+  /** @brief ShouldRender checks the display policy for a frame
+  * @param timestamp -- Timestamp of the frame in seconds
+  * @return true if the frame is due to be drawn, false if it should be skipped
+  */
+  bool shouldRender(const double timestamp);
+
   /** @brief DrawPoints displays the landmark points on the image
   * @param points  -- The landmark points
   */
-  void drawPoints(affdex::VecFeaturePoint points);
+  void drawPoints(const affdex::VecFeaturePoint& points);
+
+  /** @brief DrawPoints displays the landmark points of all the faces in a single pass.
+  * Each point stamps a precomputed anti-aliased dot, clipped to the image bounds,
+  * instead of rasterizing a circle per point.
+  * @param faces  -- The faces whose landmark points to display
+  */
+  void drawPoints(const std::map<affdex::FaceId, affdex::Face>& faces);
 
   /** @brief DrawBoundingBox displays the bounding box
   * @param top_left      -- The top left point
@@ -31,6 +132,7 @@ public:
   void drawBoundingBox(cv::Point2f top_left, cv::Point2f bottom_right, float valence);
 
   /** @brief DrawHeadOrientation Displays head orientation and associated value
+  * @param panel       -- Cached HUD layer to draw into
   * @param name        -- Name of the classifier
   * @param value       -- Value we are trying to display
   * @param x           -- The x value of the location
@@ -38,10 +140,11 @@ public:
   * @param align_right -- Whether to right or left justify the text
   * @param color       -- Color
   */
-  void drawHeadOrientation(affdex::Orientation headAngles, const int x, int &padding,
+  void drawHeadOrientation(HudPanel& panel, affdex::Orientation headAngles, const int x, int &padding,
                            bool align_right=true, cv::Scalar color=cv::Scalar(255,255,255));
 
   /** @brief DrawAppearance Draws appearance metrics on screen
+  * @param panel       -- Cached HUD layer to draw into
   * @param appearance  -- affdex::Appearance metrics
   * @param value       -- Value we are trying to display
   * @param x           -- The x value of the location
@@ -49,20 +152,59 @@ public:
   * @param align_right -- Whether to right or left justify the text
   * @param color       -- Color
   */
-  void drawAppearance(affdex::Appearance appearance, const int x, int &padding,
+  void drawAppearance(HudPanel& panel, affdex::Appearance appearance, const int x, int &padding,
                       bool align_right=true, cv::Scalar color=cv::Scalar(255,255,255));
 
 
-  /** @brief DrawFaceMetrics Displays all facial metrics and associated value
+  /** @brief DrawFaceMetrics Displays all facial metrics and associated value.
+  * The metrics are kept in a cached layer per face id and only the rows whose
+  * values changed since the previous frame are redrawn.
   * @param face         -- The affdex::Face object to display
   * @param bounding_box -- The bounding box coordinates
   */
-  void drawFaceMetrics(affdex::Face face, std::vector<cv::Point2f> bounding_box);
+  void drawFaceMetrics(const affdex::Face& face, const std::vector<cv::Point2f>& bounding_box);
+
+  /** @brief DrawFaces displays the bounding boxes and metrics of all the faces in the frame.
+  * The cached metric layers of the faces are updated in parallel, one face per task. The
+  * image is then split into horizontal bands composited in parallel, each band drawing
+  * every face in order, so overlapping faces never write the same pixels concurrently.
+  * @param faces          -- The faces to display
+  * @param bounding_boxes -- Bounding box of each face, in the iteration order of faces
+  */
+  void drawFaces(const std::map<affdex::FaceId, affdex::Face>& faces,
+                 const std::vector<std::vector<cv::Point2f> >& bounding_boxes);
+
+  /** @brief SetHudDebug outlines the HUD areas that were redrawn on each frame
+  * @param debug -- Whether to draw the outlines
+  */
+  void setHudDebug(const bool debug);
+
+  /** @brief SetSparklines plots the recent history of some metrics under each face.
+  * The plots scroll as frames arrive, only the newest segment of each line is drawn.
+  * @param metrics -- Names of emotions or expressions, unknown names are ignored; empty disables
+  * @param seconds -- Length of the history shown
+  */
+  void setSparklines(const std::vector<std::string>& metrics, const float seconds = 10);
 
-  /** @brief ShowImage displays image on screen
+  /** @brief ShowImage displays image on screen and hands it to the registered frame sinks
   */
   void showImage();
 
+  /** @brief SetShowWindow enables or disables the on screen window, sinks still receive frames
+  * @param show -- Whether to display the image with cv::imshow
+  */
+  void setShowWindow(const bool show);
+
+  /** @brief AddFrameSink registers a consumer of the annotated frames
+  * @param sink -- The sink, must outlive the Visualizer or be removed before destruction
+  */
+  void addFrameSink(FrameSink* sink);
+
+  /** @brief HasFrameSinks
+  * @return true if at least one frame sink is registered
+  */
+  bool hasFrameSinks() const;
+
   /**
    * Overlay an image with an Alpha (foreground) channel over background
    * Assumes foreground.size() == background.size()
@@ -84,110 +226,182 @@ public:
   std::map<affdex::Age, std::string> AGE_MAP;
   std::map<affdex::Ethnicity, std::string> ETHNICITY_MAP;
 
+  /** @brief Color lookup tables shared by the bounding boxes, valence and equalizers
+  */
+  const ColorgenRedGreen valence_color_generator;
+  const ColorgenLinear white_yellow_generator;
+
   zmq::context_t context();  
   zmq::socket_t publisher();
 
 private:
 
+  /** @brief Cached HUD layers of one face, left and right of the bounding box
+  */
+  struct FaceHud
+  {
+    HudPanel left;
+    HudPanel right;
+    unsigned long last_frame;
+    cv::Point left_anchor;
+    cv::Point right_anchor;
+    cv::Point top_left;
+    cv::Point bottom_right;
+    cv::Scalar box_color;
+    HudPanel sparklines;
+    cv::Point sparkline_anchor;
+    MetricHistory history;
+    std::vector<float> samples;
+    std::vector<float> drawn_samples;  // Values at the right end of the plot, where the next segment starts
+    double sparkline_carry;
+  };
+
+  /** @brief SparklineMetric locates a plotted metric within affdex::Face
+  */
+  struct SparklineMetric
+  {
+    bool emotion;
+    size_t index;
+    float low;
+    cv::Scalar color;
+  };
+
+  /** @brief RenderSparklines records the face's metrics and scrolls their plots
+  */
+  void renderSparklines(FaceHud& hud, const affdex::Face& face);
+
+  /** @brief RedrawSparklines draws the plots from the recorded history, when they cannot be scrolled
+  */
+  void redrawSparklines(FaceHud& hud);
+
+  /** @brief SparklineY maps a metric value to a row of the plot
+  */
+  int sparklineY(const SparklineMetric& metric, const size_t row, const float value) const;
+
+  /** @brief LogoImage holds the logo resized for one image width, ready to be blended
+  */
+  struct LogoImage
+  {
+    cv::Mat color;  // Premultiplied BGR
+    cv::Mat alpha;
+  };
+
+  /** @brief LogoFor returns the logo resized for an image width, resizing it only the first time
+  * that width is seen. The embedded logo is only wrapped once something is drawn.
+  * @param width -- Width of the image the logo is drawn on
+  */
+  const LogoImage& logoFor(const int width);
+
+  /** @brief DrawLogo blends the logo in the top right corner of the image
+  */
+  void drawLogo();
+
+  class HudRenderBody;
+  class HudCompositeBody;
+
+  /** @brief FaceHud looks up (or creates) the cached layers of a face and positions them
+  * @param face         -- The face being drawn
+  * @param bounding_box -- The bounding box coordinates, in display coordinates
+  */
+  FaceHud& faceHud(const affdex::Face& face, const std::vector<cv::Point2f>& bounding_box);
+
+  /** @brief RenderFaceHud redraws the rows of the cached layers whose values changed.
+  * Only touches the given FaceHud, so different faces can be rendered concurrently.
+  */
+  void renderFaceHud(FaceHud& hud, const affdex::Face& face);
+
+  /** @brief CompositeFaceHud blends a face's bounding box and cached layers onto an image
+  * @param hud    -- The face's cached layers
+  * @param target -- Image (or band of the image) to draw on
+  * @param offset -- Position of target within the full image
+  */
+  void compositeFaceHud(const FaceHud& hud, cv::Mat& target, const cv::Point& offset) const;
+
+  /** @brief PanelBounds computes the area covered by a column of metrics relative to its anchor
+  * @param names       -- Names of all the rows in the column
+  * @param align_right -- Whether the column is right or left justified
+  */
+  cv::Rect panelBounds(const std::vector<std::string>& names, const bool align_right) const;
+
   /** @brief DrawClassifierOutput Displays a classifier and associated value
+  * @param panel       -- Cached HUD layer to draw into
   * @param name        -- Name of the classifier
   * @param value       -- Value we are trying to display
   * @param loc         -- Exact location. When aligh_right is (true/false) this should be the (upper-right, upper-left)
   * @param align_right -- Whether to right or left justify the text
   */
-  void drawClassifierOutput(const std::string& classifier, const float value,
+  void drawClassifierOutput(HudPanel& panel, const std::string& classifier, const float value,
                             const cv::Point2f& loc, bool align_right=false );
   /** @brief DrawValues displays a list of classifiers and associated values
+  * @param panel       -- Cached HUD layer to draw into
   * @param names       -- Names of the classifiers to show
   * @param value       -- Value we are trying to display
   * @param x           -- The x value of the location
   * @param padding     -- The padding value
   * @param align_right -- Whether to right or left justify the text
   */
-  void drawValues(const float * first, const std::vector<std::string> names,
+  void drawValues(HudPanel& panel, const float * first, const std::vector<std::string>& names,
                   const int x, int &padding, const cv::Scalar clr, const bool align_right);
 
 
   /** @brief DrawEqualizer displays an equalizer on screen either right or left justified at the anchor location (loc)
+  * @param panel       -- Cached HUD layer to draw into
   * @param name        -- Name of the classifier
   * @param value       -- Value we are trying to display
   * @param loc         -- Exact location. When aligh_right is (true/false) this should be the (upper-right, upper-left)
   * @param align_right -- Whether to right or left justify the text
   * @param color       -- Color
   */
-  void drawEqualizer(const std::string& name, const float value, const cv::Point2f& loc,
+  void drawEqualizer(HudPanel& panel, const std::string& name, const float value, const cv::Point2f& loc,
                      bool align_right, cv::Scalar color);
 
   /** @brief DrawText displays an text on screen either right or left justified at the anchor location (loc)
+  * @param panel       -- Cached HUD layer to draw into
   * @param name        -- Name of the classifier
   * @param value       -- Value we are trying to display
   * @param loc         -- Exact location. When aligh_right is (true/false) this should be the (upper-right, upper-left)
   * @param align_right -- Whether to right or left justify the text
   * @param color       -- Color
   */
-  void drawText(const std::string& name, const std::string& value,
+  void drawText(HudPanel& panel, const char* name, const char* value,
                 const cv::Point2f loc, bool align_right=false, cv::Scalar color=cv::Scalar(255,255,255));
 
 
+  /** @brief StampLandmark blends the landmark sprite centered on a point of the image
+  * @param center -- Center of the dot, in display coordinates
+  */
+  void stampLandmark(const cv::Point& center);
+
+  /** @brief ToDisplay maps a point from frame coordinates to preview coordinates
+  */
+  cv::Point2f toDisplay(const cv::Point2f& pt) const { return cv::Point2f(pt.x * display_scale, pt.y * display_scale); }
+
   cv::Mat img;
-  cv::Mat logo;
-  bool logo_resized;
+  cv::Mat scaled_img;
+  LogoImage logo;
+  std::map<int, LogoImage> logo_cache;
+  cv::Mat landmark_sprite;
+  float display_scale;
+  double display_interval;
+  double last_render_ts;
+  bool show_window;
+  bool hud_debug;
+  unsigned long frame_counter;
+  std::map<affdex::FaceId, FaceHud> hud_cache;
+  cv::Rect left_panel_bounds;
+  cv::Rect right_panel_bounds;
+  size_t left_panel_rows;
+  std::vector<FaceHud*> frame_huds;
+  std::vector<const affdex::Face*> frame_faces;
+  std::vector<cv::Point2f> display_box;
+  std::vector<FrameSink*> frame_sinks;
+  std::vector<std::string> sparkline_names;
+  std::vector<SparklineMetric> sparkline_metrics;
+  float sparkline_seconds;
+  int sparkline_label_width;
   const int spacing = 20;
+  const int sparkline_width = 150;
+  const int sparkline_row_height = 24;
   const int LOGO_PADDING = 20;
 
 };
-
-/** @brief Color generator (linear) for red-to-green values
- */
-class ColorgenRedGreen
-{
-public:
-    /** @brief ColorgenRedGreen
-     * @param[in] red_val - Value which will return green
-     * @param green_val - Value which will return green
-     */
-    ColorgenRedGreen( const float red_val, const float green_val )
-        :
-          red_val_(red_val),
-          green_val_(green_val)
-    {}
-
-    /** @brief Generate accessor
-     * @param val -- Value for which we would like to generate a color
-     * @return  BGR Scalar for use in open cv plotting functions (e.g. cv::circle)
-     */
-    cv::Scalar operator()( const float val ) const;
-
-private:
-    const float red_val_;
-    const float green_val_;
-};
-
-/**
- * @brief Color generator (linear) between any two colors
- */
-class ColorgenLinear
-{
-public:
-    ColorgenLinear( const float val1, const float val2, cv::Scalar color1, cv::Scalar color2 )
-        :
-          val1_(val1),
-          val2_(val2),
-          color1_(color1),
-          color2_(color2)
-    {}
-
-    /** @brief Generate accessor
-     * @param val -- Value for which we would like to generate a color
-     * @return  BGR Scalar for use in open cv plotting functions (e.g. cv::circle)
-     */
-    cv::Scalar operator()( const float val ) const;
-
-private:
-  const float val1_;
-  const float val2_;
-
-  const cv::Scalar color1_;
-  const cv::Scalar color2_;
-
-};
@@ -0,0 +1,108 @@
+/*
+  embed-logo converts the binary PPM logo into a header holding its pixels ready
+  to be blended: premultiplied BGR and a separate opacity plane. It runs at build
+  time, so the demos never decode the logo.
+
+  The logo has no alpha channel of its own, its red channel is used as the opacity.
+
+  Usage: embed-logo <input.ppm> <output.h>
+*/
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Skips whitespace and comments between the fields of a PPM header
+    void skipSeparators(std::istream& in)
+    {
+        while (in)
+        {
+            int c = in.peek();
+            if (c == '#') in.ignore(4096, '\n');
+            else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') in.get();
+            else break;
+        }
+    }
+
+    void writeArray(std::ofstream& out, const char* name, const std::vector<unsigned char>& values)
+    {
+        const size_t per_line = 16;
+        out << "const unsigned char " << name << "[] =\n{";
+        char hex[8];
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (i % per_line == 0) out << "\n    ";
+            std::snprintf(hex, sizeof(hex), "0x%02X,", values[i]);
+            out << hex;
+        }
+        out << "\n};\n\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.ppm> <output.h>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    std::string magic;
+    int width = 0, height = 0, max_value = 0;
+    in >> magic;
+    skipSeparators(in);
+    in >> width;
+    skipSeparators(in);
+    in >> height;
+    skipSeparators(in);
+    in >> max_value;
+    in.get();   // Single whitespace before the raster
+
+    if (!in || magic != "P6" || width <= 0 || height <= 0 || max_value != 255)
+    {
+        std::cerr << "Unsupported logo " << argv[1] << ", expecting a binary 8 bit PPM" << std::endl;
+        return 1;
+    }
+
+    const size_t pixels = (size_t)width * height;
+    std::vector<unsigned char> rgb(pixels * 3);
+    if (!in.read((char*)rgb.data(), rgb.size()))
+    {
+        std::cerr << "Truncated logo " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned char> bgr(pixels * 3);
+    std::vector<unsigned char> alpha(pixels);
+    for (size_t i = 0; i < pixels; i++)
+    {
+        const unsigned a = rgb[i * 3];
+        alpha[i] = (unsigned char)a;
+        for (int c = 0; c < 3; c++)
+        {
+            bgr[i * 3 + c] = (unsigned char)((rgb[i * 3 + 2 - c] * a + 127) / 255);
+        }
+    }
+
+    std::ofstream out(argv[2], std::ios::binary);
+    out << "/*\n"
+        << "  affdex_small_logo.h, generated by embed-logo from affdex_small_logo.ppm. Do not edit.\n"
+        << "  Premultiplied BGR pixels and opacity of the logo.\n"
+        << "*/\n"
+        << "#pragma once\n\n"
+        << "const int affdex_small_logo_width = " << width << ";\n"
+        << "const int affdex_small_logo_height = " << height << ";\n\n";
+    writeArray(out, "affdex_small_logo_bgr", bgr);
+    writeArray(out, "affdex_small_logo_alpha", alpha);
+
+    if (!out)
+    {
+        std::cerr << "Unable to write " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
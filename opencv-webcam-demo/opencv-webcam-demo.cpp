@@ -1,6 +1,9 @@
 #include <iostream>
 #include <memory>
 #include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
 #include <fstream>
 #include <boost/filesystem.hpp>
 #include <boost/timer/timer.hpp>
@@ -16,6 +19,19 @@
 #include "AFaceListener.hpp"
 #include "PlottingImageListener.hpp"
 #include "StatusListener.hpp"
+#include "VideoRecorder.h"
+#include "MjpegServer.h"
+#include "TrackInterpolator.h"
+#include "FrameDelay.h"
+#include "CaptureThread.h"
+#include "CaptureFormat.h"
+#include "RawFrameFile.h"
+#include "MosaicRenderer.h"
+#include "SourcePipeline.h"
+#include "RegionOfInterest.h"
+#include <algorithm>
+#include <mutex>
+#include <thread>
 #include <zmq.hpp>
 #include <msgpack.hpp>
 //#include <zmq.h>
@@ -25,6 +41,88 @@ using namespace affdex;
 
 float emosens[9] = {0,0,0,0,0,0,0,0,0};
 
+/// <summary>
+/// Runs one pipeline per camera or video file and shows them together in a mosaic window.
+/// Results are published like in the single camera mode, tagged with the index of their source.
+/// </summary>
+static int runSources(const std::vector<std::string>& sources, const PipelineConfig& config, const bool draw,
+                      const bool pin_cpus, zmq::socket_t& publisher)
+{
+    // The socket is shared by the pipeline threads and is not thread safe
+    std::mutex publisher_mutex;
+    auto publish = [&](const int source, const std::map<FaceId, Face>& faces, const double timestamp)
+    {
+        for (auto & face_id_pair : faces)
+        {
+            const Emotions& emotions = face_id_pair.second.emotions;
+            std::ostringstream ss;
+            ss << emotions.joy << ";" << emotions.fear << ";" << emotions.disgust << ";"
+                << emotions.sadness << ";" << emotions.anger << ";" << emotions.surprise << ";"
+                << emotions.contempt << ";" << emotions.valence << ";" << emotions.engagement << ";"
+                << std::fixed << std::setprecision(6) << timestamp << ";" << source;
+            const std::string body(ss.str());
+            const std::string hd = "aff";
+
+            std::lock_guard<std::mutex> lg(publisher_mutex);
+            zmq::message_t message(hd.size());
+            memcpy(message.data(), hd.data(), hd.size());
+            publisher.send(message, ZMQ_SNDMORE);
+            zmq::message_t msg(body.size());
+            memcpy(msg.data(), body.data(), body.size());
+            publisher.send(msg);
+        }
+    };
+
+    shared_ptr<MosaicRenderer> mosaicPtr;
+    if (draw)
+    {
+        mosaicPtr = make_shared<MosaicRenderer>(sources.size(), cv::Size(1920, 1080), config.display_fps);
+    }
+
+    // All the sources share the same time base, so their results can be lined up
+    const auto start_time = std::chrono::steady_clock::now();
+    const unsigned int cpus = std::thread::hardware_concurrency();
+    std::vector<std::unique_ptr<SourcePipeline> > pipelines;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        const int cpu = pin_cpus && cpus > 0 ? (int)(i % cpus) : -1;
+        FrameSink* sink = mosaicPtr ? mosaicPtr->stream(i) : nullptr;
+        pipelines.push_back(std::unique_ptr<SourcePipeline>(
+            new SourcePipeline((int)i, sources[i], config, start_time, publish, sink, cpu)));
+        if (mosaicPtr)
+        {
+            mosaicPtr->setLabel(i, std::to_string(i) + ": " + sources[i]);
+        }
+        std::cerr << "Starting source " << i << ": " << sources[i];
+        if (cpu >= 0) std::cerr << " on CPU " << cpu;
+        std::cerr << std::endl;
+        pipelines.back()->start();
+    }
+
+    // highgui windows belong to this thread, the pipelines only draw into the mosaic
+    while (std::any_of(pipelines.begin(), pipelines.end(),
+                       [](const std::unique_ptr<SourcePipeline>& pipeline) { return pipeline->isRunning(); }))
+    {
+#ifdef _WIN32
+        if (GetAsyncKeyState(VK_ESCAPE)) break;
+#endif
+        if (!mosaicPtr || !mosaicPtr->present())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    for (auto & pipeline : pipelines)
+    {
+        pipeline->stop();
+        std::cerr << "Source " << pipeline->getId() << " (" << pipeline->getSource() << "): "
+            << pipeline->getCapturedCount() << " frames, "
+            << pipeline->getResultCount() << " results, "
+            << pipeline->getDroppedCount() << " dropped by the capture thread" << std::endl;
+    }
+    return 0;
+}
+
 /// <summary>
 /// Project for demoing the Windows SDK CameraDetector class (grabbing and processing frames from the camera).
 /// </summary>
@@ -60,6 +158,32 @@ int main(int argsc, char ** argsv)
         int camera_id = 0;
         unsigned int nFaces = 1;
         bool draw_display = true;
+        float display_fps = 0;
+        float display_scale = 1.0f;
+        std::string record_path;
+        unsigned short mjpeg_port = 0;
+        float mjpeg_fps = 10;
+        bool hud_debug = false;
+        bool draw_landmarks = false;
+        std::vector<std::string> sparklines;
+        float sparkline_seconds = 10;
+        bool interpolate = false;
+        bool capture_thread = true;
+        bool capture_position = false;
+        float target_latency = 0;
+        int max_in_flight = 0;
+        std::vector<std::string> sources;
+        bool pin_cpus = false;
+        std::vector<int> roi;
+        bool auto_roi = false;
+        float roi_margin = 0.5f;
+        float detect_scale = 1.0f;
+        std::string fourcc;
+        std::string raw_record_path;
+        double raw_record_seconds = 0;
+        std::string replay_path;
+        double replay_speed = 1.0;
+        int capture_ring = 4;
         int faceDetectorMode = (int)FaceDetectorMode::LARGE_FACES;
 
         float last_timestamp = -1.0f;
@@ -80,11 +204,37 @@ int main(int argsc, char ** argsv)
             ("resolution,r", po::value< std::vector<int> >(&resolution)->default_value(DEFAULT_RESOLUTION, "640 480")->multitoken(), "Resolution in pixels (2-values): width height")
             ("pfps", po::value< int >(&process_framerate)->default_value(30), "Processing framerate.")
             ("cfps", po::value< int >(&camera_framerate)->default_value(30), "Camera capture framerate.")
+            ("fourcc", po::value< std::string >(&fourcc)->default_value(""), "Camera pixel format, e.g. MJPG or YUYV (empty keeps the driver's choice).")
             ("bufferLen", po::value< int >(&buffer_length)->default_value(30), "process buffer size.")
             ("cid", po::value< int >(&camera_id)->default_value(0), "Camera ID.")
             ("faceMode", po::value< int >(&faceDetectorMode)->default_value((int)FaceDetectorMode::LARGE_FACES), "Face detector mode (large faces vs small faces).")
             ("numFaces", po::value< unsigned int >(&nFaces)->default_value(1), "Number of faces to be tracked.")
             ("draw", po::value< bool >(&draw_display)->default_value(true), "Draw metrics on screen.")
+            ("displayFps", po::value< float >(&display_fps)->default_value(0), "Maximum display framerate (0 draws every processed frame).")
+            ("displayScale", po::value< float >(&display_scale)->default_value(1.0f), "Scale factor of the displayed frame (0 < scale <= 1).")
+            ("record", po::value< std::string >(&record_path)->default_value(""), "Record the annotated frames to a video file.")
+            ("mjpegPort", po::value< unsigned short >(&mjpeg_port)->default_value(0), "Serve the annotated frames as MJPEG over HTTP on this localhost port (0 disables).")
+            ("mjpegFps", po::value< float >(&mjpeg_fps)->default_value(10), "Maximum framerate of the MJPEG stream.")
+            ("hudDebug", po::value< bool >(&hud_debug)->default_value(false), "Outline the metric areas redrawn on each frame.")
+            ("drawLandmarks", po::value< bool >(&draw_landmarks)->default_value(false), "Draw the facial landmark points.")
+            ("sparklines", po::value< std::vector<std::string> >(&sparklines)->multitoken(), "Emotions or expressions plotted over time under each face.")
+            ("sparklineSeconds", po::value< float >(&sparkline_seconds)->default_value(10), "Length of the history shown by the sparklines, in seconds.")
+            ("interpolate", po::value< bool >(&interpolate)->default_value(false), "Publish and draw every captured frame, interpolating the faces between processed frames.")
+            ("captureThread", po::value< bool >(&capture_thread)->default_value(true), "Read the camera on a dedicated thread.")
+            ("captureRing", po::value< int >(&capture_ring)->default_value(4), "Number of frame buffers of the capture thread (at least 3).")
+            ("capturePosition", po::value< bool >(&capture_position)->default_value(false), "Take frame intervals from the capture backend's buffer times when it reports them.")
+            ("targetLatency", po::value< float >(&target_latency)->default_value(0), "Skip frames to keep the latency from submission to results under this many milliseconds (0 submits every frame).")
+            ("maxInFlight", po::value< int >(&max_in_flight)->default_value(0), "With targetLatency, maximum number of frames waiting in the detector (0 uses bufferLen).")
+            ("sources", po::value< std::vector<std::string> >(&sources)->multitoken(), "Camera ids or video files analyzed side by side, one detector each (replaces --cid).")
+            ("pinCpus", po::value< bool >(&pin_cpus)->default_value(false), "With sources, pin each source's threads to its own CPU.")
+            ("roi", po::value< std::vector<int> >(&roi)->multitoken(), "Region of the frame analyzed, in pixels (4-values): x y width height")
+            ("autoRoi", po::value< bool >(&auto_roi)->default_value(false), "Analyze only the region around the faces found (within roi if given).")
+            ("roiMargin", po::value< float >(&roi_margin)->default_value(0.5f), "With autoRoi, margin around the faces relative to their size.")
+            ("detectScale", po::value< float >(&detect_scale)->default_value(1.0f), "Scale factor of the frames handed to the detector (0 < scale <= 1).")
+            ("recordRaw", po::value< std::string >(&raw_record_path)->default_value(""), "Record the captured frames and their timestamps to a raw file for --replay.")
+            ("rawRecordSeconds", po::value< double >(&raw_record_seconds)->default_value(0), "With recordRaw, seconds of frames at cfps the file has room for from the start, so it does not have to grow while recording.")
+            ("replay", po::value< std::string >(&replay_path)->default_value(""), "Replay frames recorded with --recordRaw instead of reading the camera.")
+            ("replaySpeed", po::value< double >(&replay_speed)->default_value(1.0), "Replay rate relative to the recording (0 replays as fast as the frames are taken, without dropping any).")
             ;
         po::variables_map args;
         try
@@ -121,12 +271,92 @@ int main(int argsc, char ** argsv)
             std::cerr << "Resolutions must be positive number." << std::endl;
             return 1;
         }
+        if (detect_scale <= 0 || detect_scale > 1)
+        {
+            std::cerr << "Detection scale must be in the range (0, 1]." << std::endl;
+            return 1;
+        }
+        if (!roi.empty() && (roi.size() != 4 || roi[2] <= 0 || roi[3] <= 0))
+        {
+            std::cerr << "The region of interest must be given as x y width height, with a positive size." << std::endl;
+            return 1;
+        }
+        if (display_scale <= 0 || display_scale > 1)
+        {
+            std::cerr << "Display scale must be in the range (0, 1]." << std::endl;
+            return 1;
+        }
+        if (replay_speed < 0)
+        {
+            std::cerr << "Replay speed must not be negative." << std::endl;
+            return 1;
+        }
+        if (raw_record_seconds < 0)
+        {
+            std::cerr << "Raw recording length must not be negative." << std::endl;
+            return 1;
+        }
+
+        if (!sources.empty())
+        {
+            // Options of the single source path that the pipelines do not implement
+            const char* single_source_options[] = { "cid", "fourcc", "record", "mjpegPort", "mjpegFps", "interpolate",
+                                                    "captureThread", "targetLatency", "maxInFlight", "roi", "autoRoi",
+                                                    "roiMargin", "detectScale", "recordRaw", "rawRecordSeconds",
+                                                    "replay", "replaySpeed" };
+            bool unsupported = false;
+            for (const char* option : single_source_options)
+            {
+                if (args.count(option) && !args[option].defaulted())
+                {
+                    std::cerr << "--" << option << " cannot be combined with --sources." << std::endl;
+                    unsupported = true;
+                }
+            }
+            if (unsupported) return 1;
+
+            PipelineConfig config;
+            config.data_folder = DATA_FOLDER;
+            config.process_framerate = process_framerate;
+            config.camera_framerate = camera_framerate;
+            config.buffer_length = buffer_length;
+            config.faces = nFaces;
+            config.face_mode = faceDetectorMode;
+            config.resolution = resolution;
+            config.capture_ring = capture_ring;
+            config.capture_position = capture_position;
+            config.display_fps = display_fps;
+            config.display_scale = display_scale;
+            config.draw_landmarks = draw_landmarks;
+            config.hud_debug = hud_debug;
+            config.sparklines = sparklines;
+            config.sparkline_seconds = sparkline_seconds;
+            return runSources(sources, config, draw_display, pin_cpus, publisher);
+        }
 
         std::ofstream csvFileStream;
 
         std::cerr << "Initializing Affdex FrameDetector" << endl;
         shared_ptr<FaceListener> faceListenPtr(new AFaceListener());
         shared_ptr<PlottingImageListener> listenPtr(new PlottingImageListener(csvFileStream, draw_display));    // Instanciate the ImageListener class
+        listenPtr->setDisplayPolicy(display_fps, display_scale);
+        listenPtr->setHudDebug(hud_debug);
+        listenPtr->setDrawLandmarks(draw_landmarks);
+        listenPtr->setSparklines(sparklines, sparkline_seconds);
+        listenPtr->setDetectScale(detect_scale);
+        shared_ptr<VideoRecorder> recorderPtr;
+        if (!record_path.empty())
+        {
+            recorderPtr = make_shared<VideoRecorder>(record_path, display_fps > 0 ? display_fps : camera_framerate);
+            listenPtr->addFrameSink(recorderPtr.get());
+        }
+        shared_ptr<MjpegServer> mjpegPtr;
+        if (mjpeg_port != 0)
+        {
+            mjpegPtr = make_shared<MjpegServer>(mjpeg_port, "127.0.0.1", mjpeg_fps);
+            listenPtr->addFrameSink(mjpegPtr.get());
+            std::cerr << "Serving MJPEG preview on http://localhost:" << mjpeg_port << "/" << std::endl;
+        }
         shared_ptr<StatusListener> videoListenPtr(new StatusListener());
         frameDetector = make_shared<FrameDetector>(buffer_length, process_framerate, nFaces, (affdex::FaceDetectorMode) faceDetectorMode);        // Init the FrameDetector Class
 
@@ -140,13 +370,44 @@ int main(int argsc, char ** argsv)
         frameDetector->setFaceListener(faceListenPtr.get());
         frameDetector->setProcessStatusListener(videoListenPtr.get());
 
-        cv::VideoCapture webcam(camera_id);    //Connect to the first webcam
-        webcam.set(CV_CAP_PROP_FPS, camera_framerate);    //Set webcam framerate.
-        webcam.set(CV_CAP_PROP_FRAME_WIDTH, resolution[0]);
-        webcam.set(CV_CAP_PROP_FRAME_HEIGHT, resolution[1]);
-        std::cerr << "Setting the webcam frame rate to: " << camera_framerate << std::endl;
-        auto start_time = std::chrono::system_clock::now();
-        if (!webcam.isOpened())
+        // A recording replaces the camera, its frames keep their recorded timestamps
+        cv::VideoCapture webcam;
+        CaptureFormat capture_format(fourcc);
+        shared_ptr<RawFrameReplay> replayPtr;
+        if (!replay_path.empty())
+        {
+            replayPtr = make_shared<RawFrameReplay>(replay_path, replay_speed);
+            if (!replayPtr->isOpened()) return 1;
+            std::cerr << "Replaying " << replayPtr->getFrameCount() << " frames of " << replayPtr->getSize().width
+                << "x" << replayPtr->getSize().height << " at " << replay_speed << "x" << std::endl;
+        }
+        else
+        {
+            webcam.open(camera_id);    //Connect to the first webcam
+            // The pixel format limits which sizes and rates the camera offers, so it is set first
+            if (!capture_format.apply(webcam))
+            {
+                std::cerr << "The webcam does not support the " << fourcc << " format" << std::endl;
+            }
+            webcam.set(CV_CAP_PROP_FPS, camera_framerate);    //Set webcam framerate.
+            webcam.set(CV_CAP_PROP_FRAME_WIDTH, resolution[0]);
+            webcam.set(CV_CAP_PROP_FRAME_HEIGHT, resolution[1]);
+            std::cerr << "Setting the webcam frame rate to: " << camera_framerate << std::endl;
+            std::cerr << "Webcam reports: " << CaptureFormat::describe(webcam) << std::endl;
+        }
+        // Frame timestamps are relative to this point, on a clock that never goes backwards
+        const auto start_time = std::chrono::steady_clock::now();
+        CaptureClock capture_clock(start_time, capture_position);
+
+        // Frames are skipped before reaching the detector when results come back late
+        shared_ptr<RateController> ratePtr;
+        if (target_latency > 0)
+        {
+            ratePtr = make_shared<RateController>(capture_clock, target_latency / 1000.0, process_framerate,
+                                                  max_in_flight > 0 ? max_in_flight : buffer_length);
+            listenPtr->setRateController(ratePtr.get());
+        }
+        if (!replayPtr && !webcam.isOpened())
         {
             std::cerr << "Error opening webcam!" << std::endl;
             return 1;
@@ -170,31 +431,9 @@ int main(int argsc, char ** argsv)
         //Start the frame detector thread.
         frameDetector->start();
 
-        do{
-            cv::Mat img;
-            if (!webcam.read(img))    //Capture an image from the camera
-            {
-                std::cerr << "Failed to read frame from webcam! " << std::endl;
-                break;
-            }
-
-            //Calculate the Image timestamp and the capture frame rate;
-            const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - start_time);
-            const double seconds = milliseconds.count() / 1000.f;
-
-            // Create a frame
-            Frame f(img.size().width, img.size().height, img.data, Frame::COLOR_FORMAT::BGR, seconds);
-            capture_fps = 1.0f / (seconds - last_timestamp);
-            last_timestamp = seconds;
-            frameDetector->process(f);  //Pass the frame to detector
-
-            // For each frame processed
-            if (listenPtr->getDataSize() > 0)
-            {
-
-                std::pair<Frame, std::map<FaceId, Face> > dataPoint = listenPtr->getData();
-                Frame frame = dataPoint.first;
-                std::map<FaceId, Face> faces = dataPoint.second;
+        // Publishes the emotions of the faces and draws them on the frame
+        auto handleFaces = [&](const std::map<FaceId, Face>& faces, Frame frame)
+        {
 		 
 		//EmoSens
 
@@ -232,7 +471,8 @@ int main(int argsc, char ** argsv)
 				emosens[5] << ";" <<
 				emosens[6] << ";" <<
 				emosens[7] << ";" <<
-				emosens[8];
+				emosens[8] << ";" <<
+				std::fixed << std::setprecision(6) << frame.getTimestamp();
 	
         std::string emostring(ss.str()); 
 	//char buffer[emostring.size()];
@@ -271,7 +511,7 @@ int main(int argsc, char ** argsv)
 
 
                 // Draw metrics to the GUI
-                if (draw_display)
+                if (listenPtr->isRendering())
                 {
                     listenPtr->draw(faces, frame);
                 }
@@ -279,7 +519,14 @@ int main(int argsc, char ** argsv)
                 std::cerr << "timestamp: " << frame.getTimestamp()
                     << " cfps: " << listenPtr->getCaptureFrameRate()
                     << " pfps: " << listenPtr->getProcessingFrameRate()
-                    << " faces: " << faces.size() << endl;
+                    << " faces: " << faces.size();
+                if (ratePtr)
+                {
+                    std::cerr << " submitted fps: " << ratePtr->getRate()
+                        << " latency: " << ratePtr->getLatency() << " ms"
+                        << " in flight: " << ratePtr->getInFlight();
+                }
+                std::cerr << endl;
 
                   
 
@@ -291,8 +538,150 @@ int main(int argsc, char ** argsv)
 
                 //Output metrics to the file
                 //listenPtr->outputToFile(faces, frame.getTimestamp());
+        };
+
+        // The detector only sees this part of the frame, results are moved back to the full frame
+        shared_ptr<RegionOfInterest> roiPtr;
+        if (!roi.empty() || auto_roi)
+        {
+            const cv::Rect bounds = roi.empty() ? cv::Rect() : cv::Rect(roi[0], roi[1], roi[2], roi[3]);
+            roiPtr = make_shared<RegionOfInterest>(bounds, auto_roi, roi_margin);
+        }
+
+        // Downscaled frames for the detector, the buffer is reused as long as the resolution stays the same
+        cv::Mat detect_buffer;
+        const bool detect_whole_frame = !roiPtr && detect_scale == 1.0f;
+
+        TrackInterpolator interpolator;
+        std::map<FaceId, Face> interpolated_faces;
+        // With interpolation, frames wait for the result after them, at most two result intervals
+        FrameDelay delayed_frames;
+        const double max_delay = 2.0 / process_framerate;
+        unsigned long captured_frames = 0;
+        unsigned long results = 0;
+        const std::clock_t start_cpu = std::clock();
+
+        VideoCaptureSource webcam_source(webcam, capture_clock);
+        webcam_source.setFormat(&capture_format);
+        FrameSource* source = replayPtr ? (FrameSource*)replayPtr.get() : &webcam_source;
+        shared_ptr<RawFrameRecorder> rawRecorderPtr;
+        if (!raw_record_path.empty())
+        {
+            rawRecorderPtr = make_shared<RawFrameRecorder>(*source, raw_record_path,
+                                                           (size_t)std::ceil(raw_record_seconds * camera_framerate));
+            source = rawRecorderPtr.get();
+        }
+
+        // Frames are read on their own thread unless --captureThread is off, see the jitter printed on exit
+        shared_ptr<CaptureThread> capturePtr;
+        JitterMeter capture_jitter;
+        if (capture_thread)
+        {
+            capturePtr = make_shared<CaptureThread>(*source, capture_ring);
+            // An unpaced replay waits for the pipeline, so every recorded frame is processed
+            capturePtr->setLossless(replayPtr && replay_speed == 0);
+            capturePtr->start();
+        }
+
+        do{
+            cv::Mat img;
+            double seconds;
+            const CapturedFrame* captured = nullptr;
+            if (capturePtr)
+            {
+                // The newest frame, it stays valid until released at the end of the iteration
+                captured = capturePtr->acquire();
+                if (captured == nullptr) break;
+                img = captured->image;
+                seconds = captured->timestamp;
+            }
+            else
+            {
+                //Capture an image from the camera, timestamped before it is decoded
+                if (!source->read(img, seconds))
+                {
+                    if (!source->atEnd()) std::cerr << "Failed to read frame from webcam! " << std::endl;
+                    break;
+                }
+                capture_jitter.add(seconds);
+            }
+
+            // Create a frame
+            const cv::Mat* detect_img = roiPtr ? &roiPtr->crop(img, seconds) : &img;
+            if (detect_scale != 1.0f)
+            {
+                cv::resize(*detect_img, detect_buffer, cv::Size(), detect_scale, detect_scale, cv::INTER_AREA);
+                detect_img = &detect_buffer;
+            }
+            Frame f(detect_img->size().width, detect_img->size().height, detect_img->data, Frame::COLOR_FORMAT::BGR, seconds);
+            capture_fps = 1.0f / (seconds - last_timestamp);
+            last_timestamp = seconds;
+            if (!ratePtr || ratePtr->shouldSubmit(seconds))
+            {
+                frameDetector->process(f);  //Pass the frame to detector
+            }
+            captured_frames++;
+            const bool has_result = listenPtr->getDataSize() > 0;
+            if (!detect_whole_frame && (has_result || interpolate))
+            {
+                // Drawing needs the whole frame
+                f = Frame(img.size().width, img.size().height, img.data, Frame::COLOR_FORMAT::BGR, seconds);
+            }
+
+            // For each frame processed
+            if (has_result)
+            {
+
+                std::pair<Frame, std::map<FaceId, Face> > dataPoint = listenPtr->getData();
+                Frame frame = dataPoint.first;
+                std::map<FaceId, Face> faces = dataPoint.second;
+                results++;
+                // Faces of a crop that is not known any more cannot be placed in the frame
+                const bool mapped = !roiPtr || roiPtr->mapBack(faces, frame.getTimestamp());
+                if (!detect_whole_frame)
+                {
+                    // The result is drawn over the newest frame, its own is cropped or downscaled;
+                    // the listener has already scaled the landmarks back up
+                    const float timestamp = frame.getTimestamp();
+                    frame = f;
+                    frame.setTimestamp(timestamp);
+                }
+
+                if (mapped && interpolate)
+                {
+                    // Published and drawn below, along with the frames in between results
+                    interpolator.update(faces, frame.getTimestamp());
+                }
+                else if (mapped)
+                {
+                    handleFaces(faces, frame);
+                }
             }
 
+            // Every captured frame is published and drawn with the faces estimated at its timestamp,
+            // once a result at or after it is known, so it lies between two results
+            if (interpolate)
+            {
+                // Stamped like the results, which carry the timestamp of their Frame
+                delayed_frames.push(img, f.getTimestamp());
+                while (!delayed_frames.empty() && (delayed_frames.frontTimestamp() <= interpolator.getLatestTimestamp() ||
+                                                   seconds - delayed_frames.frontTimestamp() > max_delay))
+                {
+                    const double timestamp = delayed_frames.frontTimestamp();
+                    cv::Mat& delayed = delayed_frames.front();
+                    if (interpolator.interpolate(timestamp, interpolated_faces))
+                    {
+                        handleFaces(interpolated_faces, Frame(delayed.size().width, delayed.size().height, delayed.data,
+                                                              Frame::COLOR_FORMAT::BGR, timestamp));
+                    }
+                    delayed_frames.pop();
+                }
+            }
+
+            if (capturePtr)
+            {
+                capturePtr->release(captured);
+            }
 
         }
 
@@ -303,6 +692,75 @@ int main(int argsc, char ** argsv)
 #endif
         std::cerr << "Stopping FrameDetector Thread" << endl;
         frameDetector->stop();    //Stop frame detector thread
+
+        if (capturePtr)
+        {
+            capturePtr->stop();
+            capture_jitter = capturePtr->getJitter();
+            std::cerr << "Capture thread grabbed " << capturePtr->getGrabbedCount() << " frames"
+                << " (dropped: " << capturePtr->getDroppedCount();
+            if (rawRecorderPtr) std::cerr << ", lost growing the raw file: " << rawRecorderPtr->getStalledCount();
+            std::cerr << ")" << std::endl;
+        }
+        if (ratePtr)
+        {
+            std::cerr << "Submitted " << ratePtr->getSubmittedCount() << " frames to the detector"
+                << " (skipped: " << ratePtr->getSkippedCount()
+                << ", no result: " << ratePtr->getExpiredCount()
+                << ", effective rate: " << ratePtr->getRate() << " fps"
+                << ", latency: " << ratePtr->getLatency() << " ms)" << std::endl;
+        }
+        if (rawRecorderPtr)
+        {
+            std::cerr << "Recorded " << rawRecorderPtr->getRecordedCount() << " raw frames to " << raw_record_path
+                << " (file grown " << rawRecorderPtr->getGrowCount() << " times, stalled "
+                << 1000.0 * rawRecorderPtr->getStallTime() << " ms)" << std::endl;
+        }
+        if (replayPtr)
+        {
+            std::cerr << "Replayed " << replayPtr->getReplayedCount() << " of " << replayPtr->getFrameCount() << " frames" << std::endl;
+        }
+        if (roiPtr)
+        {
+            const cv::Rect& region = roiPtr->getRegion();
+            std::cerr << "Cropped " << roiPtr->getCroppedCount() << " frames (copied: " << roiPtr->getCopiedCount()
+                << ", results skipped: " << roiPtr->getUnmappedCount()
+                << "), last region: " << region.x << " " << region.y << " " << region.width << " " << region.height << std::endl;
+        }
+        std::cerr << "Capture interval: " << capture_jitter.getMeanInterval() << " ms"
+            << ", jitter: " << capture_jitter.getJitter() << " ms"
+            << ", max: " << capture_jitter.getMaxInterval() << " ms" << std::endl;
+        // Cameras silently fall back to lower rates, e.g. in low light or when the bandwidth runs out
+        if (!replayPtr && capture_jitter.getMeanInterval() > 0)
+        {
+            std::cerr << "Delivered " << 1000.0 / capture_jitter.getMeanInterval() << " fps"
+                << " (requested: " << camera_framerate << " fps)" << std::endl;
+        }
+
+        // Compare runs with different --pfps to see what the detector costs
+        const double wall_seconds = capture_clock.now();
+        std::cerr << "Captured " << captured_frames << " frames"
+            << (interpolate ? ", interpolated from " : ", ")
+            << (interpolate ? std::to_string(interpolator.getResultCount()) + " results" : std::string("no interpolation"))
+            << ", CPU time: " << (double)(std::clock() - start_cpu) / CLOCKS_PER_SEC << " s"
+            << " over " << wall_seconds << " s" << std::endl;
+        std::cerr << "Detector returned " << results << " results (" << results / std::max(wall_seconds, 1e-3)
+            << " per second) on " << detect_scale << "x frames" << std::endl;
+
+        if (mjpegPtr)
+        {
+            mjpegPtr->stop();
+        }
+
+        if (recorderPtr)
+        {
+            recorderPtr->stop();
+            std::cerr << "Recorded " << recorderPtr->getWrittenCount() << " frames to " << record_path
+                << " (dropped: " << recorderPtr->getDroppedCount()
+                << ", repeated: " << recorderPtr->getRepeatedCount()
+                << ", enqueue: " << recorderPtr->getEnqueueTime() << " ms/frame"
+                << ", encode: " << recorderPtr->getEncodeTime() << " ms/frame)" << std::endl;
+        }
     }
     catch (AffdexException ex)
     {
@@ -0,0 +1,140 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "FaceGeometry.h"
+
+/** Checks computeFaceGeometry against the two scans it replaced and straightforward sums, for every
+ * point count from 0 to 199 on random points, and the landmark distances on faces of 34 points.
+ */
+
+namespace
+{
+    int failures = 0;
+
+    void expect(const bool condition, const char* what, const size_t count)
+    {
+        if (condition) return;
+        std::cout << "FAIL " << what << " with " << count << " points" << std::endl;
+        failures++;
+    }
+
+    bool near(const double a, const double b, const double tolerance)
+    {
+        return std::fabs(a - b) <= tolerance * (std::max)(1.0, std::fabs(b));
+    }
+
+    // The bounding box as PlottingImageListener computed it before, one scan per corner
+
+    cv::Point2f minPoint(const affdex::VecFeaturePoint& points)
+    {
+        affdex::VecFeaturePoint::const_iterator it = points.begin();
+        affdex::FeaturePoint ret = *it;
+        for (; it != points.end(); it++)
+        {
+            if (it->x < ret.x) ret.x = it->x;
+            if (it->y < ret.y) ret.y = it->y;
+        }
+        return cv::Point2f(ret.x, ret.y);
+    }
+
+    cv::Point2f maxPoint(const affdex::VecFeaturePoint& points)
+    {
+        affdex::VecFeaturePoint::const_iterator it = points.begin();
+        affdex::FeaturePoint ret = *it;
+        for (; it != points.end(); it++)
+        {
+            if (it->x > ret.x) ret.x = it->x;
+            if (it->y > ret.y) ret.y = it->y;
+        }
+        return cv::Point2f(ret.x, ret.y);
+    }
+
+    float randomCoordinate(const float range)
+    {
+        return range * std::rand() / RAND_MAX - range / 4;
+    }
+
+    void checkAgainstScans(const affdex::VecFeaturePoint& points, const FaceGeometry& geometry, const char* kernel)
+    {
+        const size_t count = points.size();
+        expect(geometry.count == count, kernel, count);
+        if (count == 0)
+        {
+            expect(geometry.top_left == cv::Point2f() && geometry.spread == 0 && geometry.eye_distance == 0, kernel, count);
+            return;
+        }
+
+        // Extrema are exact, whatever the order of the comparisons
+        expect(geometry.top_left == minPoint(points), kernel, count);
+        expect(geometry.bottom_right == maxPoint(points), kernel, count);
+
+        double sum_x = 0, sum_y = 0;
+        for (const affdex::FeaturePoint& point : points)
+        {
+            sum_x += point.x;
+            sum_y += point.y;
+        }
+        const double mean_x = sum_x / count, mean_y = sum_y / count;
+        double squares = 0;
+        for (const affdex::FeaturePoint& point : points)
+        {
+            squares += (point.x - mean_x) * (point.x - mean_x) + (point.y - mean_y) * (point.y - mean_y);
+        }
+        expect(near(geometry.centroid.x, mean_x, 1e-5) && near(geometry.centroid.y, mean_y, 1e-5), kernel, count);
+        expect(near(geometry.spread, std::sqrt(squares / count), 1e-3), kernel, count);
+    }
+
+    float pointDistance(const affdex::VecFeaturePoint& p, const int a, const int b)
+    {
+        return std::sqrt((p[a].x - p[b].x) * (p[a].x - p[b].x) + (p[a].y - p[b].y) * (p[a].y - p[b].y));
+    }
+}
+
+int main(int argc, char ** argsv)
+{
+    std::srand(37);
+    for (int round = 0; round < 20; round++)
+    {
+        // Large coordinates in some rounds, where float sums would lose the spread
+        const float range = round % 2 ? 4000.0f : 100000.0f;
+        for (size_t count = 0; count < 200; count++)
+        {
+            affdex::VecFeaturePoint points(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                points[i].id = (int)i;
+                points[i].x = randomCoordinate(range);
+                points[i].y = randomCoordinate(range);
+            }
+            const FaceGeometry geometry = computeFaceGeometry(points);
+            const FaceGeometry scalar = computeFaceGeometryScalar(points);
+            checkAgainstScans(points, geometry, "computeFaceGeometry");
+            checkAgainstScans(points, scalar, "computeFaceGeometryScalar");
+            expect(geometry.top_left == scalar.top_left && geometry.bottom_right == scalar.bottom_right,
+                   "kernels agree on the bounds", count);
+
+            // Distances are only measured on the 34 point layout, and the same by both kernels
+            const bool layout = count == 34;
+            expect((geometry.jaw_width != 0) == layout && geometry.jaw_width == scalar.jaw_width &&
+                   geometry.eye_distance == scalar.eye_distance && geometry.mouth_width == scalar.mouth_width &&
+                   geometry.mouth_opening == scalar.mouth_opening, "distances only on the 34 point layout", count);
+            if (layout)
+            {
+                expect(near(geometry.jaw_width, pointDistance(points, 0, 4), 1e-6), "jaw width", count);
+                expect(near(geometry.mouth_width, pointDistance(points, 20, 24), 1e-6), "mouth width", count);
+                expect(near(geometry.mouth_opening, pointDistance(points, 28, 29), 1e-6), "mouth opening", count);
+                affdex::VecFeaturePoint eyes(2);
+                eyes[0].x = (points[16].x + points[17].x) / 2;
+                eyes[0].y = (points[16].y + points[17].y) / 2;
+                eyes[1].x = (points[18].x + points[19].x) / 2;
+                eyes[1].y = (points[18].y + points[19].y) / 2;
+                expect(near(geometry.eye_distance, pointDistance(eyes, 0, 1), 1e-6), "eye distance", count);
+            }
+        }
+    }
+
+    std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
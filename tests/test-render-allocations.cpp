@@ -0,0 +1,124 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "FaceGeometry.h"
+#include "HudPanel.h"
+#include "Visualizer.h"
+#include "SyntheticFaces.h"
+
+/** Checks that rendering a frame whose faces are already known does not allocate. Every call to
+ * the global operator new is counted while a frame is rendered; cv::Mat buffers come from
+ * cv::fastMalloc and are not counted, only the containers and strings of the render path are.
+ */
+
+namespace
+{
+    std::atomic<bool> counting(false);
+    std::atomic<unsigned long> allocations(0);
+
+    int failures = 0;
+
+    void expect(const bool condition, const char* what, const unsigned long count)
+    {
+        std::cout << (condition ? "ok   " : "FAIL ") << what << ": " << count << " allocations" << std::endl;
+        if (!condition) failures++;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if (counting) allocations++;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+/** Text rows of a HUD panel store the text they were drawn with, storing new values must reuse it
+ */
+void testPanelRowText()
+{
+    HudPanel panel;
+    panel.reset(cv::Rect(0, 0, 200, 100), 4);
+    const char* texts[] = { "0.0", "-12.5", "caucasian", "a text of thirty one characters" };
+
+    allocations = 0;
+    counting = true;
+    for (int i = 0; i < 1000; i++)
+    {
+        panel.changed(i % 4, texts[i % 4], cv::Scalar(255, 255, 255));
+        panel.changed(i % 4, texts[(i + 1) % 4], cv::Scalar(255, 255, 255));
+    }
+    counting = false;
+    expect(allocations == 0, "panel row text", allocations);
+}
+
+/** Once the faces have been seen, drawing them again allocates nothing: the HUD layers, their row
+ * state, the layout and the bounding boxes are all reused.
+ */
+void testSteadyFrame(const int count)
+{
+    const int width = 1280;
+    const int height = 720;
+    const cv::Mat background(height, width, CV_8UC3, cv::Scalar(60, 60, 60));
+    cv::Mat image;
+
+    Visualizer viz;
+    viz.setShowWindow(false);
+    viz.setSparklines(std::vector<std::string>{ "joy", "valence" });
+    const std::map<affdex::FaceId, affdex::Face> faces = syntheticFaces(count, width, height, 0);
+    std::vector<std::vector<cv::Point2f> > boxes(faces.size());
+
+    const int warmup = 5;
+    const int frames = 100;
+    // The HUD prints some values to stdout
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    allocations = 0;
+    for (int frame = 0; frame < warmup + frames; frame++)
+    {
+        background.copyTo(image);
+        counting = frame >= warmup;
+        viz.shouldRender(frame / 30.0);
+        viz.updateImage(image);
+        size_t i = 0;
+        for (auto& face_id_pair : faces)
+        {
+            boundingBoxCorners(computeFaceGeometry(face_id_pair.second.featurePoints), boxes[i++]);
+        }
+        viz.drawPoints(faces);
+        viz.drawFaces(faces, boxes);
+        counting = false;
+    }
+    std::cout.rdbuf(out);
+    expect(allocations == 0, count == 1 ? "steady frame, 1 face" : "steady frame, several faces", allocations);
+}
+
+int main(int argc, char ** argsv)
+{
+    // The parallel loops run inline, so the thread pool's own bookkeeping is not counted
+    cv::setNumThreads(0);
+
+    testPanelRowText();
+    testSteadyFrame(1);
+    testSteadyFrame(4);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include <cmath>
+#include <iostream>
+
+#include "VideoDecoder.h"
+
+/** Checks that VideoDecoder samples the frames a sampling rate asks for: for common video framerates
+ * and sampling rates, the frames kept must be the first at or after each point of the grid, with the
+ * media times the backends report, computed from the frame number or rounded to milliseconds.
+ */
+
+namespace
+{
+    int failures = 0;
+
+    // Media time of frame i as OpenCV's FFmpeg backend reports it through CV_CAP_PROP_POS_MSEC
+    double computedTime(const long long i, const int fps)
+    {
+        return 1000.0 * i / fps / 1000.0;
+    }
+
+    // Media time of frame i as backends reporting whole milliseconds do
+    double roundedTime(const long long i, const int fps)
+    {
+        return std::floor(1000.0 * i / fps + 0.5) / 1000.0;
+    }
+
+    void checkSampling(const int fps, const int rate, const bool rounded)
+    {
+        // Picked as VideoDecoder::run does, compared with exact integer arithmetic: frame i is kept
+        // when it is the first with i / fps >= k / rate for some k
+        long long last_slot = -1;
+        int mismatches = 0;
+        const long long frames = 3600LL * fps;
+        for (long long i = 0; i < frames; i++)
+        {
+            const double timestamp = rounded ? roundedTime(i, fps) : computedTime(i, fps);
+            const long long slot = VideoDecoder::sampleSlot(timestamp, (float)rate);
+            const bool kept = slot > last_slot;
+            if (kept) last_slot = slot;
+
+            const bool expected = i == 0 || (i * rate) / fps != ((i - 1) * rate) / fps;
+            if (kept != expected) mismatches++;
+        }
+        if (mismatches > 0)
+        {
+            std::cout << "FAIL " << rate << " of " << fps << " fps" << (rounded ? " (rounded)" : "") << ": "
+                << mismatches << " frames picked wrong" << std::endl;
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    const int framerates[] = { 24, 25, 30, 50, 60 };
+    const int rates[] = { 1, 2, 5, 10, 12, 15, 24, 25, 30 };
+    for (int fps : framerates)
+    {
+        for (int rate : rates)
+        {
+            if (rate > fps) continue;
+            checkSampling(fps, rate, false);
+            checkSampling(fps, rate, true);
+        }
+    }
+
+    std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -2,25 +2,50 @@
 #include <memory>
 #include <chrono>
 #include <fstream>
+#include <algorithm>
+#include <deque>
 
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/algorithm/string.hpp>
 #include <boost/timer/timer.hpp>
 #include <boost/program_options.hpp>
 
 #include "VideoDetector.h"
+#include "FrameDetector.h"
 #include "PhotoDetector.h"
 #include "AffdexException.h"
 
 #include "AFaceListener.hpp"
 #include "PlottingImageListener.hpp"
 #include "StatusListener.hpp"
+#include "VideoRecorder.h"
+#include "MjpegServer.h"
+#include "SegmentedVideoProcessor.h"
+#include "BatchProcessor.h"
+#include "ImagePrefetcher.h"
+#include "VideoDecoder.h"
+#include <thread>
 
 
 using namespace std;
 using namespace affdex;
 
+/// <summary>
+/// Matches a file name against a pattern where * stands for any run of characters and ? for any one character.
+/// </summary>
+static bool matchesPattern(const char* name, const char* pattern)
+{
+    if (*pattern == '\0') return *name == '\0';
+    if (*pattern == '*')
+    {
+        return matchesPattern(name, pattern + 1) || (*name != '\0' && matchesPattern(name + 1, pattern));
+    }
+    return *name != '\0' && (*pattern == '?' || *pattern == *name) && matchesPattern(name + 1, pattern + 1);
+}
+
 int main(int argsc, char ** argsv)
 {
 
@@ -34,10 +59,29 @@ int main(int argsc, char ** argsv)
                                                             {boost::filesystem::path(".mp4"), 1} };
     affdex::path DATA_FOLDER;
     affdex::path videoPath;
+    affdex::path inputDir;
+    affdex::path inputList;
+    int workers = 2;
+    affdex::path imageSequence;
+    int decoders = std::max(1u, std::thread::hardware_concurrency());
+    size_t lookahead = 32;
 
     int process_framerate = 30;
     bool draw_display = true;
+    float display_fps = 0;
+    float display_scale = 1.0f;
+    std::string record_path;
+    unsigned short mjpeg_port = 0;
+    float mjpeg_fps = 10;
+    bool hud_debug = false;
+    bool draw_landmarks = false;
+    std::vector<std::string> sparklines;
+    float sparkline_seconds = 10;
     bool loop = false;
+    bool decode_ahead = false;
+    size_t decode_queue = 32;
+    int segments = 1;
+    float segment_overlap = 2;
     unsigned int nFaces = 1;
     int faceDetectorMode = (int)FaceDetectorMode::LARGE_FACES;
 
@@ -51,16 +95,38 @@ int main(int argsc, char ** argsv)
     ("help,h", po::bool_switch()->default_value(false), "Display this help message.")
 #ifdef _WIN32
     ("data,d", po::wvalue< affdex::path >(&DATA_FOLDER)->default_value(affdex::path(L"data"), std::string("data")), "Path to the data folder")
-    ("input,i", po::wvalue< affdex::path >(&videoPath)->required(), "Video file to processs")
+    ("input,i", po::wvalue< affdex::path >(&videoPath), "Video file to processs")
+    ("inputDir", po::wvalue< affdex::path >(&inputDir), "Folder of video files to process (replaces --input).")
+    ("inputList", po::wvalue< affdex::path >(&inputList), "Text file listing the video files to process, one per line (replaces --input).")
+    ("imageSequence", po::wvalue< affdex::path >(&imageSequence), "Folder of images, or pattern such as frames/*.jpg, processed in name order (replaces --input).")
 #else // _WIN32
     ("data,d", po::value< affdex::path >(&DATA_FOLDER)->default_value(affdex::path("data"), std::string("data")), "Path to the data folder")
-    ("input,i", po::value< affdex::path >(&videoPath)->required(), "Video file to processs")
+    ("input,i", po::value< affdex::path >(&videoPath), "Video file to processs")
+    ("inputDir", po::value< affdex::path >(&inputDir), "Folder of video files to process (replaces --input).")
+    ("inputList", po::value< affdex::path >(&inputList), "Text file listing the video files to process, one per line (replaces --input).")
+    ("imageSequence", po::value< affdex::path >(&imageSequence), "Folder of images, or pattern such as frames/*.jpg, processed in name order (replaces --input).")
 #endif // _WIN32
     ("pfps", po::value< int >(&process_framerate)->default_value(30), "Processing framerate.")
     ("draw", po::value< bool >(&draw_display)->default_value(true), "Draw video on screen.")
+    ("displayFps", po::value< float >(&display_fps)->default_value(0), "Maximum display framerate (0 draws every processed frame).")
+    ("displayScale", po::value< float >(&display_scale)->default_value(1.0f), "Scale factor of the displayed frame (0 < scale <= 1).")
+    ("record", po::value< std::string >(&record_path)->default_value(""), "Record the annotated frames to a video file.")
+    ("mjpegPort", po::value< unsigned short >(&mjpeg_port)->default_value(0), "Serve the annotated frames as MJPEG over HTTP on this localhost port (0 disables).")
+    ("mjpegFps", po::value< float >(&mjpeg_fps)->default_value(10), "Maximum framerate of the MJPEG stream.")
+    ("hudDebug", po::value< bool >(&hud_debug)->default_value(false), "Outline the metric areas redrawn on each frame.")
+    ("drawLandmarks", po::value< bool >(&draw_landmarks)->default_value(false), "Draw the facial landmark points.")
+    ("sparklines", po::value< std::vector<std::string> >(&sparklines)->multitoken(), "Emotions or expressions plotted over time under each face.")
+    ("sparklineSeconds", po::value< float >(&sparkline_seconds)->default_value(10), "Length of the history shown by the sparklines, in seconds.")
     ("faceMode", po::value< int >(&faceDetectorMode)->default_value((int)FaceDetectorMode::SMALL_FACES), "Face detector mode (large faces vs small faces).")
     ("numFaces", po::value< unsigned int >(&nFaces)->default_value(1), "Number of faces to be tracked.")
     ("loop", po::value< bool >(&loop)->default_value(false), "Loop over the video being processed.")
+    ("decoders", po::value< int >(&decoders)->default_value(decoders), "With imageSequence, number of threads decoding images ahead of the detector.")
+    ("lookahead", po::value< size_t >(&lookahead)->default_value(32), "With imageSequence, maximum number of images decoded ahead of the detector.")
+    ("decodeAhead", po::value< bool >(&decode_ahead)->default_value(false), "Decode the video on a separate thread and feed a FrameDetector, instead of letting a VideoDetector read it.")
+    ("decodeQueue", po::value< size_t >(&decode_queue)->default_value(32), "With decodeAhead, maximum number of frames decoded ahead of the detector.")
+    ("segments", po::value< int >(&segments)->default_value(1), "Split the video into this many segments processed in parallel, without display.")
+    ("workers", po::value< int >(&workers)->default_value(2), "With inputDir or inputList, number of files processed at the same time.")
+    ("segmentOverlap", po::value< float >(&segment_overlap)->default_value(2), "With segments, seconds of video analyzed before each segment to pick up the faces.")
     ;
     po::variables_map args;
     try
@@ -88,6 +154,149 @@ int main(int argsc, char ** argsv)
         std::cerr << description << std::endl;
         return 1;
     }
+    if (display_scale <= 0 || display_scale > 1)
+    {
+        std::cerr << "Display scale must be in the range (0, 1]." << std::endl;
+        return 1;
+    }
+    const int inputs_given = !videoPath.empty() + !inputDir.empty() + !inputList.empty() + !imageSequence.empty();
+    if (inputs_given != 1)
+    {
+        std::cerr << "ERROR: exactly one of --input, --inputDir, --inputList and --imageSequence is required." << std::endl << std::endl;
+        std::cerr << "For help, use the -h option." << std::endl << std::endl;
+        return 1;
+    }
+    if (decoders < 1 || lookahead < 1)
+    {
+        std::cerr << "At least one decoder and one image of lookahead are required." << std::endl;
+        return 1;
+    }
+    if (workers < 1)
+    {
+        std::cerr << "At least one worker is required." << std::endl;
+        return 1;
+    }
+    if (segments < 1 || segment_overlap < 0)
+    {
+        std::cerr << "At least one segment and a positive overlap are required." << std::endl;
+        return 1;
+    }
+    if (!inputDir.empty() || !inputList.empty())
+    {
+        std::vector<boost::filesystem::path> inputs;
+        if (!inputDir.empty())
+        {
+            if (!boost::filesystem::is_directory(inputDir))
+            {
+                std::cerr << "Input folder doesn't exist: " << boost::filesystem::path(inputDir) << std::endl;
+                return 1;
+            }
+            for (boost::filesystem::directory_iterator it(inputDir), end; it != end; ++it)
+            {
+                if (boost::filesystem::is_regular_file(it->status()) && VIDEO_EXTS[it->path().extension()])
+                {
+                    inputs.push_back(it->path());
+                }
+            }
+            std::sort(inputs.begin(), inputs.end());
+        }
+        else
+        {
+            boost::filesystem::ifstream list(inputList);
+            if (!list.is_open())
+            {
+                std::cerr << "Unable to open input list " << boost::filesystem::path(inputList) << std::endl;
+                return 1;
+            }
+            std::string line;
+            while (std::getline(list, line))
+            {
+                boost::algorithm::trim(line);
+                if (!line.empty() && line[0] != '#') inputs.push_back(line);
+            }
+        }
+        if (inputs.empty())
+        {
+            std::cerr << "No video files to process." << std::endl;
+            return 1;
+        }
+
+        // Every worker starts its own detector once and keeps it for all the files it takes
+        const auto started = std::chrono::steady_clock::now();
+        BatchProcessor batch(workers, DATA_FOLDER, process_framerate, nFaces, faceDetectorMode,
+                             [](const BatchReport& report)
+        {
+            if (report.input.empty())
+            {
+                std::cerr << "[worker " << report.worker << "] " << report.error << std::endl;
+            }
+            else if (report.succeeded)
+            {
+                std::cerr << "[worker " << report.worker << "] " << report.input << ": " << report.frames
+                    << " frames in " << report.seconds << " s (" << report.frames / std::max(report.seconds, 1e-3)
+                    << " fps), output written to " << report.output << std::endl;
+            }
+            else
+            {
+                std::cerr << "[worker " << report.worker << "] " << report.input << " FAILED: " << report.error << std::endl;
+            }
+        });
+        batch.process(inputs);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        const unsigned long unprocessed = inputs.size() - batch.getSucceededCount() - batch.getFailedCount();
+        std::cout << "Processed " << batch.getSucceededCount() << " of " << inputs.size() << " files ("
+            << batch.getFailedCount() << " failed, " << unprocessed << " not processed), "
+            << batch.getFrameCount() << " frames in " << elapsed << " s ("
+            << batch.getFrameCount() / std::max(elapsed, 1e-3) << " fps), "
+            << batch.getStartupTime() << " s spent starting detectors" << std::endl;
+        return batch.getFailedCount() + unprocessed > 0 ? 1 : 0;
+    }
+
+    // An image sequence is written next to its folder: the results to <folder>.csv, and the file
+    // of each index, used as the timestamp of its results, to <folder>.index.csv
+    std::vector<boost::filesystem::path> sequenceFiles;
+    boost::filesystem::path sequenceBase;
+    if (!imageSequence.empty())
+    {
+        boost::filesystem::path folder(imageSequence);
+        std::string pattern = "*";
+        if (!boost::filesystem::is_directory(folder))
+        {
+            pattern = folder.filename().string();
+            folder = folder.has_parent_path() ? folder.parent_path() : boost::filesystem::path(".");
+        }
+        if (!boost::filesystem::is_directory(folder))
+        {
+            std::cerr << "Image folder doesn't exist: " << folder << std::endl;
+            return 1;
+        }
+
+        const std::vector<std::string> image_exts = { ".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff" };
+        for (boost::filesystem::directory_iterator it(folder), end; it != end; ++it)
+        {
+            const std::string ext = boost::algorithm::to_lower_copy(it->path().extension().string());
+            if (boost::filesystem::is_regular_file(it->status()) &&
+                std::find(image_exts.begin(), image_exts.end(), ext) != image_exts.end() &&
+                matchesPattern(it->path().filename().string().c_str(), pattern.c_str()))
+            {
+                sequenceFiles.push_back(it->path());
+            }
+        }
+        if (sequenceFiles.empty())
+        {
+            std::cerr << "No images to process in " << folder << std::endl;
+            return 1;
+        }
+        std::sort(sequenceFiles.begin(), sequenceFiles.end());
+
+        sequenceBase = boost::filesystem::absolute(folder);
+        while (sequenceBase.filename() == "." && sequenceBase.has_parent_path())
+        {
+            sequenceBase = sequenceBase.parent_path();
+        }
+    }
+
     try
     {
         std::shared_ptr<Detector> detector;
@@ -96,6 +305,21 @@ int main(int argsc, char ** argsv)
         boost::filesystem::path csvPath(videoPath);
         boost::filesystem::path fileExt = csvPath.extension();
         csvPath.replace_extension(".csv");
+        std::ofstream indexFileStream;
+        if (!sequenceFiles.empty())
+        {
+            csvPath = sequenceBase;
+            csvPath += ".csv";
+            boost::filesystem::path indexPath(sequenceBase);
+            indexPath += ".index.csv";
+            indexFileStream.open(indexPath.c_str());
+            if (!indexFileStream.is_open())
+            {
+                std::cerr << "Unable to open index file " << indexPath << std::endl;
+                return 1;
+            }
+            indexFileStream << "TimeStamp,path,decoded" << std::endl;
+        }
         std::ofstream csvFileStream(csvPath.c_str());
 
         if (!csvFileStream.is_open())
@@ -104,7 +328,38 @@ int main(int argsc, char ** argsv)
             return 1;
         }
 
-        if (VIDEO_EXTS[fileExt]) // IF it is a video file.
+        if (VIDEO_EXTS[fileExt] && segments > 1)
+        {
+            // The listener only formats the CSV file here, the segments have their own detectors
+            PlottingImageListener csvWriter(csvFileStream, false);
+            SegmentedVideoProcessor processor(std::string(videoPath.begin(), videoPath.end()), DATA_FOLDER,
+                                              process_framerate, nFaces, faceDetectorMode,
+                                              segments, segment_overlap, process_framerate);
+            std::cerr << "Processing " << processor.getDuration() << " s of video in "
+                << processor.getSegmentCount() << " segments" << std::endl;
+
+            const auto started = std::chrono::steady_clock::now();
+            processor.process([&](const std::map<FaceId, Face>& faces, const double timestamp)
+            {
+                csvWriter.outputToFile(faces, timestamp);
+            });
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            csvFileStream.close();
+
+            std::cout << "Processed " << processor.getResultCount() << " frames in " << elapsed << " s ("
+                << processor.getDuration() / elapsed << "x realtime), "
+                << processor.getMatchedCount() << " faces followed across segments" << std::endl;
+            std::cout << "Output written to file: " << csvPath << std::endl;
+            return 0;
+        }
+
+        if (VIDEO_EXTS[fileExt] && decode_ahead)
+        {
+            // Frames are sampled at pfps by the decoder, the detector's own limit only has to let them all through
+            detector = std::make_shared<FrameDetector>(process_framerate, 2.0f * process_framerate, nFaces,
+                                                       (affdex::FaceDetectorMode) faceDetectorMode);
+        }
+        else if (VIDEO_EXTS[fileExt]) // IF it is a video file.
         {
             detector = std::make_shared<VideoDetector>(process_framerate, nFaces, (affdex::FaceDetectorMode) faceDetectorMode);
         }
@@ -134,6 +389,25 @@ int main(int argsc, char ** argsv)
 
         std::cout << "Face detector mode set to: " << mode << std::endl;
         shared_ptr<PlottingImageListener> listenPtr(new PlottingImageListener(csvFileStream, draw_display));
+        listenPtr->setDisplayPolicy(display_fps, display_scale);
+        listenPtr->setHudDebug(hud_debug);
+        listenPtr->setDrawLandmarks(draw_landmarks);
+        listenPtr->setSparklines(sparklines, sparkline_seconds);
+        shared_ptr<VideoRecorder> recorderPtr;
+        if (!record_path.empty())
+        {
+            // Image sequences are timestamped with their index, one image per second
+            const double record_fps = !imageSequence.empty() ? 1.0 : (display_fps > 0 ? display_fps : process_framerate);
+            recorderPtr = make_shared<VideoRecorder>(record_path, record_fps);
+            listenPtr->addFrameSink(recorderPtr.get());
+        }
+        shared_ptr<MjpegServer> mjpegPtr;
+        if (mjpeg_port != 0)
+        {
+            mjpegPtr = make_shared<MjpegServer>(mjpeg_port, "127.0.0.1", mjpeg_fps);
+            listenPtr->addFrameSink(mjpegPtr.get());
+            std::cerr << "Serving MJPEG preview on http://localhost:" << mjpeg_port << "/" << std::endl;
+        }
 
         detector->setClassifierPath(DATA_FOLDER);
         detector->setDetectAllEmotions(true);
@@ -145,14 +419,126 @@ int main(int argsc, char ** argsv)
 
         detector->start();    //Initialize the detectors .. call only once
 
+        // Results of an image sequence are written with the exact index of their image, a float
+        // timestamp cannot tell indices apart past 2^24
+        auto handleResultAt = [&](const double timestamp) -> double
+        {
+            std::pair<Frame, std::map<FaceId, Face> > dataPoint = listenPtr->getData();
+            Frame frame = dataPoint.first;
+            std::map<FaceId, Face> faces = dataPoint.second;
+
+
+            if (listenPtr->isRendering())
+            {
+                listenPtr->draw(faces, frame);
+            }
+
+            std::cerr << "timestamp: ";
+            if (timestamp < 0) std::cerr << frame.getTimestamp();
+            else std::cerr << (unsigned long long)timestamp;
+            std::cerr << " cfps: " << listenPtr->getCaptureFrameRate()
+            << " pfps: " << listenPtr->getProcessingFrameRate()
+            << " faces: "<< faces.size() << endl;
+
+            listenPtr->outputToFile(faces, timestamp < 0 ? frame.getTimestamp() : timestamp);
+            return frame.getTimestamp();
+        };
+        auto handleResult = [&]() { return handleResultAt(-1); };
+
+        // Timestamps given to a FrameDetector must keep increasing when the video loops
+        double loop_offset = 0;
         do
         {
             shared_ptr<StatusListener> videoListenPtr = std::make_shared<StatusListener>();
             detector->setProcessStatusListener(videoListenPtr.get());
-            if (VIDEO_EXTS[fileExt])
+            if (VIDEO_EXTS[fileExt] && decode_ahead)
+            {
+                VideoDecoder decoder(std::string(videoPath.begin(), videoPath.end()), (float)process_framerate, decode_queue);
+                if (!decoder.start())
+                {
+                    std::cerr << "Unable to open video file " << boost::filesystem::path(videoPath) << std::endl;
+                    break;
+                }
+
+                // Instead of letting the detector drop frames, wait for room in its buffer. A result
+                // accounts for every frame submitted up to its timestamp, so a frame the detector drops
+                // anyway is not waited for once a later one returns; the last frames may have none,
+                // so waiting gives up once results stop coming
+                const auto stall = std::chrono::seconds(2);
+                const size_t buffer_length = std::max(1, process_framerate);
+                std::deque<double> pending;
+                auto waitForResults = [&](const size_t max_pending)
+                {
+                    auto last_result = std::chrono::steady_clock::now();
+                    while (pending.size() > max_pending && std::chrono::steady_clock::now() - last_result < stall)
+                    {
+                        if (listenPtr->getDataSize() == 0)
+                        {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                            continue;
+                        }
+                        const double timestamp = handleResult();
+                        while (!pending.empty() && pending.front() <= timestamp + 1e-3)
+                        {
+                            pending.pop_front();
+                        }
+                        last_result = std::chrono::steady_clock::now();
+                    }
+                };
+
+                double last_timestamp = loop_offset;
+                while (const DecodedFrame* decoded = decoder.acquire())
+                {
+                    last_timestamp = loop_offset + decoded->timestamp;
+                    Frame frame(decoded->image.cols, decoded->image.rows, decoded->image.data,
+                                Frame::COLOR_FORMAT::BGR, (float)last_timestamp);
+                    pending.push_back(frame.getTimestamp());
+                    ((FrameDetector *)detector.get())->process(frame);
+                    decoder.release(decoded);
+                    waitForResults(buffer_length - 1);
+                }
+                waitForResults(0);
+                loop_offset = last_timestamp + 1.0 / process_framerate;
+
+                std::cout << "Decoded " << decoder.getDecodedCount() << " frames, the detector waited "
+                    << decoder.getEmptyTime() << " s for frames and the decoder "
+                    << decoder.getFullTime() << " s for room in the queue" << std::endl;
+            }
+            else if (VIDEO_EXTS[fileExt])
             {
                 ((VideoDetector *)detector.get())->process(videoPath); //Process a video
             }
+            else if (!sequenceFiles.empty())
+            {
+                // Images are decoded ahead on other threads while the detector works on the current one
+                ImagePrefetcher prefetcher(sequenceFiles, decoders, lookahead);
+                prefetcher.start();
+                while (const PrefetchedImage* image = prefetcher.next())
+                {
+                    const size_t index = image->index;
+                    indexFileStream << image->index << "," << sequenceFiles[image->index].string() << ","
+                        << (image->image.empty() ? "no" : "yes") << std::endl;
+                    if (image->image.empty())
+                    {
+                        std::cerr << "Unable to decode " << sequenceFiles[image->index] << std::endl;
+                    }
+                    else
+                    {
+                        Frame frame(image->image.cols, image->image.rows, image->image.data,
+                                    Frame::COLOR_FORMAT::BGR, (float)image->index);
+                        ((PhotoDetector *)detector.get())->process(frame);
+                    }
+                    prefetcher.release(image);
+
+                    // The PhotoDetector returns the results of an image before process returns
+                    while (listenPtr->getDataSize() > 0)
+                    {
+                        handleResultAt((double)index);
+                    }
+                }
+                std::cout << "Processed " << sequenceFiles.size() << " images (" << prefetcher.getFailedCount()
+                    << " unreadable), " << prefetcher.getWaitTime() << " s spent waiting for decoding" << std::endl;
+            }
             else
             {
 				//videoPath is of type std::wstring on windows, but std::string on other platforms.
@@ -168,29 +554,29 @@ int main(int argsc, char ** argsv)
             {
                 if (listenPtr->getDataSize() > 0)
                 {
-                    std::pair<Frame, std::map<FaceId, Face> > dataPoint = listenPtr->getData();
-                    Frame frame = dataPoint.first;
-                    std::map<FaceId, Face> faces = dataPoint.second;
-
-
-                    if (draw_display)
-                    {
-                        listenPtr->draw(faces, frame);
-                    }
-
-                    std::cerr << "timestamp: " << frame.getTimestamp()
-                    << " cfps: " << listenPtr->getCaptureFrameRate()
-                    << " pfps: " << listenPtr->getProcessingFrameRate()
-                    << " faces: "<< faces.size() << endl;
-
-                    listenPtr->outputToFile(faces, frame.getTimestamp());
+                    handleResult();
                 }
-            } while (VIDEO_EXTS[fileExt] && (videoListenPtr->isRunning() || listenPtr->getDataSize() > 0));
+            } while (VIDEO_EXTS[fileExt] && !decode_ahead && (videoListenPtr->isRunning() || listenPtr->getDataSize() > 0));
         } while(loop);
 
         detector->stop();
         csvFileStream.close();
 
+        if (mjpegPtr)
+        {
+            mjpegPtr->stop();
+        }
+
+        if (recorderPtr)
+        {
+            recorderPtr->stop();
+            std::cout << "Recorded " << recorderPtr->getWrittenCount() << " frames to " << record_path
+                << " (dropped: " << recorderPtr->getDroppedCount()
+                << ", repeated: " << recorderPtr->getRepeatedCount()
+                << ", enqueue: " << recorderPtr->getEnqueueTime() << " ms/frame"
+                << ", encode: " << recorderPtr->getEncodeTime() << " ms/frame)" << std::endl;
+        }
+
         std::cout << "Output written to file: " << csvPath << std::endl;
     }
     catch (AffdexException ex)